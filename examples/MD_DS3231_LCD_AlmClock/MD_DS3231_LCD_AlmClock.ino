@@ -55,10 +55,12 @@ almFSM_t almState = AS_IDLE;
 
 void displayUpdate(void)
 // Callback function for the RTC library
-// Display the RTC values for time and alarm2
+// Display the RTC values for time and alarm2. The date and time 
+// are displayed by the RTC time change callbacks, only when changed.
 {
-  RTC.readTime();
-  printTime();
+  uint8_t changed;
+
+  RTC.readTime(changed);
   if (almState != AS_SETTING)
   {
     RTC.readAlarm2();
@@ -103,10 +105,10 @@ void printAlarm(void)
   p2dig(almM);  
 }
 
-void printTime(void)
-// Display the current time on the display
+void printDate(void *)
+// Display the current date and day on the display
+// Called by the RTC library only when the date has changed.
 {
-  // display the date and day
   lcd.setCursor(0,0);
   lcd.print(dow2String(RTC.dow));
   lcd.print(" ");
@@ -115,8 +117,12 @@ void printTime(void)
   p2dig(RTC.mm);
   lcd.print("-");
   p2dig(RTC.dd);
-  
-  // display the current time  
+}
+
+void printTime(void *)
+// Display the current time on the display
+// Called by the RTC library every time the time has changed.
+{
   lcd.setCursor(0,1);
   p2dig(RTC.h);
   lcd.print(":");
@@ -171,6 +177,10 @@ void setup(void)
   // RTC global initialisation
   RTC.control(DS3231_12H, DS3231_OFF);  // 24 hour clock
   
+  // Date and time are only redrawn when they change
+  RTC.onDay(printDate);
+  RTC.onSecond(printTime);
+
   // Alarm 1 - initialise the 1 second alarm for screen updates
   RTC.setAlarm1Callback(displayUpdate);
   RTC.setAlarm1Type(DS3231_ALM_SEC);
@@ -38,8 +38,9 @@ const char *dow2String(uint8_t code)
   return(str[code]);
 }
 
-void printTime(void)
-// Print the current time and date to the LCD display
+void printDate(void *)
+// Print the current date to the LCD display. 
+// Called by the RTC library only when the date has changed.
 {
   lcd.setCursor(0,0);
   lcd.print(dow2String(RTC.dow));
@@ -49,7 +50,12 @@ void printTime(void)
   p2dig(RTC.mm);
   lcd.print("-");
   p2dig(RTC.dd);
-  
+}
+
+void printTime(void *)
+// Print the current time to the LCD display
+// Called by the RTC library every time the time has changed.
+{
   lcd.setCursor(0,1);
   p2dig(RTC.h);
   lcd.print(":");
@@ -61,10 +67,11 @@ void printTime(void)
 }
 
 void displayUpdate(void)
-// update the display
+// update the display - the RTC callbacks only redraw the lines that changed
 {
-  RTC.readTime();
-  printTime();
+  uint8_t changed;
+
+  RTC.readTime(changed);
 }
 
 #if USE_POLLED_CB || USE_INTERRUPT
@@ -82,6 +89,10 @@ void setup()
   lcd.clear();
   lcd.noCursor();
 
+  // set up the display update callbacks
+  RTC.onDay(printDate);
+  RTC.onSecond(printTime);
+
   /// set up the alarm environment  
 #if USE_POLLED
   // nothing more to do here
@@ -93,12 +104,14 @@ void setup()
   // set up hardware at Arduino end
   pinMode(PIN_INTERRUPT, INPUT_PULLUP);
   attachInterrupt(0, alarmICB, FALLING);
-  // set up the clock interrupt registers
+  // set up the clock interrupt registers as one batch
+  RTC.beginControl();
   RTC.control(DS3231_A2_INT_ENABLE, DS3231_ON);
   RTC.control(DS3231_A1_INT_ENABLE, DS3231_ON);  
   RTC.control(DS3231_INT_ENABLE, DS3231_ON);
   // set the Alarm flag off in case it is on
   RTC.control(DS3231_A1_FLAG, DS3231_OFF);
+  RTC.commitControl();
 #endif
 
   // now initialise the 1 second alarm for screen updates
@@ -89,7 +89,7 @@ const uint8_t  HR_PER_DAY = 24;    // hours per day
 const uint8_t  DAY_PER_WK = 7;     // days per week
 const uint8_t  MTH_PER_YEAR = 12;  // months per year
 
-const uint32_t CLOCK_UPDATE_TIME = 1000;  // in milliseconds - time resolution to nearest minute does not need rapid updates!
+const uint32_t CLOCK_UPDATE_TIME = 100;   // in milliseconds - only the seconds are read unless they wrap, so poll often to track the RTC
 const uint32_t SETUP_TIMEOUT = 60000;     // in milliseconds - timeout for setup inactivity
 const uint32_t SHOW_DELAY_TIME = 5000;    // in milliseconds - timeout for showing time mode
 const uint32_t INIT_CHECK_TIME = 1000;    // in milliseconds - initialization check per display
@@ -227,7 +227,8 @@ void drawDial(void)
   tft.fillCircle(CTR_X, CTR_Y, R_AXLE, COL_AXLE);
 }
 
-void drawHands(uint8_t hh, uint8_t mm, uint8_t ss, bool initialize = false)
+void drawHands(uint8_t hh, uint8_t mm, uint8_t ss, bool newMinute, bool initialize = false)
+// Redraw the seconds hand, and the hour and minute hands only if the minute changed
 {
   float angS, angM, angH;     // H, M, S hands angles in radians
   static point_t pS, pM, pH;  // point coordinates for H, M, S
@@ -243,7 +244,7 @@ void drawHands(uint8_t hh, uint8_t mm, uint8_t ss, bool initialize = false)
   pS.sx = cos(angS);  pS.sy = sin(angS);
 
   // redraw hour and minute hand positions every minute or when initializing
-  if (ss == 0 || initialize)
+  if (newMinute || initialize)
   {
     // clear old, calculate new, redraw new
     if (!initialize) tft.drawLine(pH.x + CTR_X, pH.y + CTR_Y, CTR_X, CTR_Y, COL_BACK);
@@ -311,7 +312,7 @@ bool configTime(uint8_t& h, uint8_t& m)
         m++;
         if (m >= MIN_PER_HR) m = 0;
         PRINT("\nM:", m);
-        drawHands(adjustedHour(h), m, 0);
+        drawHands(adjustedHour(h), m, 0, true);
       }
       break;
 
@@ -321,7 +322,7 @@ bool configTime(uint8_t& h, uint8_t& m)
         h++;
         if (h >= HR_PER_DAY) h = 0;
         PRINT("\nH:", h);
-        drawHands(adjustedHour(h), m, 0);
+        drawHands(adjustedHour(h), m, 0, true);
       }
       break;
 
@@ -375,6 +376,7 @@ void setup(void)
 void loop(void)
 {
   static bool initHands = true;
+  static bool moveHands = false;    // hour and minute hands need redrawing
   static uint32_t timeLastUpdate = 0;
   static enum stateRun_t    // loop() FSM states
   {
@@ -393,12 +395,21 @@ void loop(void)
     break;
 
   case SR_UPDATE:   // update the display
-    timeLastUpdate = millis();
-    RTC.readTime();
-    PRINTTIME("\n", adjustedHour(RTC.h), RTC.m, RTC.s);
-    drawHands(adjustedHour(RTC.h), RTC.m, RTC.s, initHands);
-    initHands = false;
-    state = SR_IDLE;
+    {
+      uint8_t changed;
+
+      timeLastUpdate = millis();
+      RTC.readTimeIncremental(changed);
+      if ((changed & ~DS3231_CHG_SEC) != 0)
+        moveHands = true;
+      if (changed != 0 || initHands || moveHands)  // only draw what has changed
+      {
+        PRINTTIME("\n", adjustedHour(RTC.h), RTC.m, RTC.s);
+        drawHands(adjustedHour(RTC.h), RTC.m, RTC.s, moveHands, initHands);
+        initHands = moveHands = false;
+      }
+      state = SR_IDLE;
+    }
     break;
 
   case SR_IDLE:   // wait for ...
@@ -422,6 +433,7 @@ void loop(void)
       RTC.s = 0;
       RTC.writeTime();
     }
+    moveHands = true;   // hands may have been moved during setup
     state = SR_UPDATE;
     break;
 
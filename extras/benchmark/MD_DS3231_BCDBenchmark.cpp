@@ -0,0 +1,118 @@
+// Host check and benchmark for the MD_DS3231 BCD time block conversion
+//
+// Checks the word at a time (SWAR) conversion of the time block against the
+// byte at a time conversion and against bin2BCD()/BCD2bin() for every value
+// 0-99 (0x00-0x99) in every byte, with and without control bits to mask off.
+// It then times both conversions.
+//
+// Build and run on Linux from this folder:
+//   g++ -std=gnu++11 -O2 -I../../src ../../src/*.cpp MD_DS3231_BCDBenchmark.cpp -o bcdBenchmark -lpthread
+//   ./bcdBenchmark
+//
+// The program prints each mismatch and returns the number of mismatches.
+// Timing depends on the host and is reported for information only.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <MD_DS3231.h>
+#include <MD_DS3231_BCD.h>
+
+const uint32_t BCD_ITERATIONS = 10000000;   // calls per conversion
+
+int checkBCD(void)
+// Return the number of time blocks the word and byte conversions disagree on.
+// Each pass puts a different value in each byte so every byte sees every value.
+{
+  const uint8_t maskAll[8] = { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff };
+  const uint8_t mask7f[8] = { 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f, 0x7f };
+  uint8_t bin[8], bcd[7], w[8], b[8];
+  int failed = 0;
+
+  for (uint8_t v = 0; v < 100; v++)
+  {
+    for (uint8_t i = 0; i < 8; i++)
+      bin[i] = (v + 13 * i) % 100;
+
+    // binary to BCD
+    memset(w, 0, sizeof(w));
+    memset(b, 0, sizeof(b));
+    encodeBCDWords(bin, w);
+    encodeBCDBytes(bin, b);
+    for (uint8_t i = 0; i < 7; i++)
+    {
+      if (w[i] != b[i] || b[i] != MD_DS3231::bin2BCD(bin[i]))
+      {
+        printf("BCD MISMATCH encode %d: word 0x%02x, byte 0x%02x\n", bin[i], w[i], b[i]);
+        failed++;
+      }
+      bcd[i] = b[i];
+    }
+
+    // BCD to binary, 0x00-0x99
+    decodeBCDWords(bcd, w, maskAll);
+    decodeBCDBytes(bcd, b, maskAll);
+    for (uint8_t i = 0; i < 7; i++)
+    {
+      if (w[i] != b[i] || b[i] != bin[i])
+      {
+        printf("BCD MISMATCH decode 0x%02x: word %d, byte %d\n", bcd[i], w[i], b[i]);
+        failed++;
+      }
+    }
+
+    // BCD to binary with a control bit to mask off, 0x00-0x79
+    for (uint8_t i = 0; i < 7; i++)
+      bcd[i] = MD_DS3231::bin2BCD(bin[i] % 80) | 0x80;
+    decodeBCDWords(bcd, w, mask7f);
+    decodeBCDBytes(bcd, b, mask7f);
+    for (uint8_t i = 0; i < 7; i++)
+    {
+      if (w[i] != b[i] || b[i] != bin[i] % 80)
+      {
+        printf("BCD MISMATCH decode 0x%02x masked: word %d, byte %d\n", bcd[i], w[i], b[i]);
+        failed++;
+      }
+    }
+  }
+
+  return(failed);
+}
+
+double timeBCD(void (*conv)(const uint8_t *, uint8_t *, const uint8_t *))
+// Return the ns per conversion of a time block
+{
+  const uint8_t mask[8] = { 0x7f, 0x7f, 0x3f, 0x07, 0x3f, 0x1f, 0xff, 0x00 };
+  uint8_t in[8] = { 0x00, 0x30, 0x12, 0x05, 0x16, 0x10, 0x26, 0x00 };
+  uint8_t out[8];
+  volatile uint8_t sink = 0;
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < BCD_ITERATIONS; i++)
+  {
+    in[0] = (uint8_t)i & 0x59;    // vary the input so the work is not hoisted out of the loop
+    conv(in, out, mask);
+    sink = sink + out[0] + out[6];
+  }
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+  return(std::chrono::duration<double, std::nano>(end - start).count() / BCD_ITERATIONS);
+}
+
+void decodeWords(const uint8_t *in, uint8_t *out, const uint8_t *mask) { decodeBCDWords(in, out, mask); }
+void decodeBytes(const uint8_t *in, uint8_t *out, const uint8_t *mask) { decodeBCDBytes(in, out, mask); }
+void encodeWords(const uint8_t *in, uint8_t *out, const uint8_t *) { encodeBCDWords(in, out); }
+void encodeBytes(const uint8_t *in, uint8_t *out, const uint8_t *) { encodeBCDBytes(in, out); }
+
+int main(void)
+{
+  int failed = checkBCD();
+
+  printf("%-20s %10s %10s\n", "BCD time block", "word ns", "byte ns");
+  printf("%-20s %10.2f %10.2f\n", "decode", timeBCD(decodeWords), timeBCD(decodeBytes));
+  printf("%-20s %10.2f %10.2f\n", "encode", timeBCD(encodeWords), timeBCD(encodeBytes));
+  printf("%d BCD mismatch(es), library uses the %s conversion\n", failed, ENABLE_SWAR_BCD ? "word" : "byte");
+
+  return(failed);
+}
@@ -0,0 +1,299 @@
+// Host benchmark for the MD_DS3231 library
+//
+// Runs the public methods of MD_DS3231 against the in-memory register file
+// transport and reports the time, I2C transactions and bytes per call. The
+// results are written as CSV. If a baseline CSV file from an earlier run is
+// given, the program fails when any method uses more bus transactions or
+// bytes than the baseline, so changes in bus traffic can be caught.
+//
+// Build and run on Linux from this folder:
+//   g++ -std=gnu++11 -O2 -I../../src ../../src/*.cpp MD_DS3231_Benchmark.cpp -o benchmark -lpthread
+//   ./benchmark [results.csv [baseline.csv]]
+//
+// Timing depends on the host and is reported for information only. The
+// bus counts are the same on every host. writeTimeAligned() waits for a
+// second boundary on each call, so it is run fewer times.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <MD_DS3231.h>
+#include <MD_DS3231_Scheduler.h>
+
+#define ARRAY_SIZE(a)  (sizeof(a)/sizeof((a)[0]))
+
+const uint32_t ITERATIONS = 100000;   // calls per method
+const uint32_t ALIGNED_ITERATIONS = 100;  // calls to methods that wait for a second boundary
+
+MD_DS3231_BusMemory mem;
+MD_DS3231_BusStats bus(mem);
+MD_DS3231 RTC(bus);
+snapshot_t snap;
+schedEvent_t events[8];
+MD_DS3231_Scheduler sched(RTC, events, ARRAY_SIZE(events));
+
+struct result_t
+{
+  const char *name;
+  double ns;
+  double transactions;
+  double bytes;
+};
+
+struct bench_t
+{
+  const char *name;
+  void (*setup)(void);
+  void (*run)(void);
+  uint32_t iterations;  // calls to time, 0 for ITERATIONS
+
+  bench_t(const char *n, void (*s)(void), void (*r)(void), uint32_t i = 0) :
+    name(n), setup(s), run(r), iterations(i) {};
+};
+
+// Test setups
+void setupDefault(void) { RTC.setShadowCache(false); RTC.control(DS3231_12H, DS3231_OFF); }
+void setupShadow(void) { setupDefault(); RTC.setShadowCache(true); RTC.status(DS3231_12H); RTC.status(DS3231_A1_FLAG); RTC.status(DS3231_INT_ENABLE); }
+void setup12H(void) { setupDefault(); RTC.control(DS3231_12H, DS3231_ON); }
+void setupAligned(void) { setupDefault(); RTC.setWriteLatency(100); }
+void setupSqw(void)
+// 1Hz square wave with an edge just counted, so each read checks the seconds register
+{
+  setupDefault();
+  RTC.control(DS3231_INT_ENABLE, DS3231_OFF);
+  RTC.control(DS3231_SQW_TYPE, DS3231_SQW_1HZ);
+  RTC.sqwEdge();
+}
+void noEvent(void *) {}
+void setupScheduler(void)
+// Events an hour and a day away, so service() finds nothing due
+{
+  uint32_t now;
+
+  setupDefault();
+  while (sched.count() != 0)
+    sched.remove(events[0].id);
+  RTC.readSecs(now);
+  sched.add(now + 3600, noEvent);
+  sched.addRecurring(now + 86400, 86400, noEvent);
+  sched.begin();
+}
+
+// Test cases, each one a call to a library method
+void readTime(void) { RTC.readTime(); }
+void writeTime(void) { RTC.writeTime(); }
+void readTimeIncremental(void) { uint8_t c; RTC.readTimeIncremental(c); }
+void readTimeStruct(void) { timeData_t t; RTC.readTime(t); }
+void writeTimeStruct(void) { timeData_t t = { 2026, 10, 16, 12, 0, 0, 6, 0 }; RTC.writeTime(t); }
+void readTimeTm(void) { struct tm tm; RTC.readTime(tm); }
+void writeTimeTm(void)
+{
+  struct tm tm = {};
+
+  tm.tm_hour = 12; tm.tm_mday = 16; tm.tm_mon = 9; tm.tm_year = 126; tm.tm_wday = 5; tm.tm_yday = 288;
+  RTC.writeTime(tm);
+}
+void readEpoch(void) { uint32_t e; RTC.readEpoch(e); }
+void writeEpoch(void) { RTC.writeEpoch(1792152000UL); }
+void readSecs(void) { uint32_t s; RTC.readSecs(s); }
+void readTimeMs(void) { uint32_t s; uint16_t ms; RTC.readTimeMs(s, ms); }
+void writeTimeAligned(void) { RTC.writeTimeAligned(845000000UL, 990); }
+void readSnapshot(void) { RTC.readSnapshot(snap); }
+void readTimeAsync(void) { RTC.readTimeAsync(); while (RTC.poll() == DS3231_ASYNC_BUSY); }
+void writeTimeAsync(void) { RTC.writeTimeAsync(); while (RTC.poll() == DS3231_ASYNC_BUSY); }
+void readAlarm1(void) { RTC.readAlarm1(); }
+void writeAlarm1(void) { RTC.writeAlarm1(DS3231_ALM_DTHMS); }
+void writeAlarm1Secs(void) { RTC.writeAlarm1Secs(845000000UL); }
+void setAlarm1Type(void) { RTC.setAlarm1Type(DS3231_ALM_HMS); }
+void getAlarm1Type(void) { RTC.getAlarm1Type(); }
+void checkAlarm1(void) { RTC.checkAlarm1(); }
+void readAlarm2(void) { RTC.readAlarm2(); }
+void writeAlarm2(void) { RTC.writeAlarm2(DS3231_ALM_HM); }
+void writeAlarms(void)
+{
+  timeData_t a1 = { 2026, 10, 16, 12, 30, 0, 6, 0 };
+  timeData_t a2 = { 2026, 10, 16, 13, 0, 0, 6, 0 };
+
+  RTC.writeAlarms(a1, DS3231_ALM_DTHMS, a2, DS3231_ALM_HM, true, true);
+}
+void setAlarm2Type(void) { RTC.setAlarm2Type(DS3231_ALM_HM); }
+void getAlarm2Type(void) { RTC.getAlarm2Type(); }
+void checkAlarm2(void) { RTC.checkAlarm2(); }
+void serviceAlarms(void) { RTC.serviceAlarms(); }
+void control(void) { RTC.control(DS3231_SQW_TYPE, DS3231_SQW_1HZ); }
+void controlBatch(void)
+{
+  RTC.beginControl();
+  RTC.control(DS3231_INT_ENABLE, DS3231_ON);
+  RTC.control(DS3231_A1_INT_ENABLE, DS3231_ON);
+  RTC.control(DS3231_A2_INT_ENABLE, DS3231_OFF);
+  RTC.commitControl();
+}
+void status(void) { RTC.status(DS3231_A1_FLAG); }
+void statusAging(void) { RTC.status(DS3231_AGING_OFFSET); }
+void readTempRegister(void) { RTC.readTempRegister(); }
+void readTemperature(void) { int16_t t; RTC.readTemperature(t); }
+void pollConversion(void) { int16_t t; RTC.pollConversion(t); }
+void readRAM(void) { uint8_t b[DS3231_RAM_MAX]; RTC.readRAM(0, b, DS3231_RAM_MAX); }
+void writeRAM(void) { uint8_t b[2] = { 0, 0 }; RTC.writeRAM(0x10, b, 1); }
+void isRunning(void) { RTC.isRunning(); }
+void schedulerService(void) { sched.service(); }
+
+const bench_t bench[] =
+{
+  { "readTime", setupDefault, readTime },
+  { "readTime_12H", setup12H, readTime },
+  { "writeTime", setupDefault, writeTime },
+  { "writeTime_shadow", setupShadow, writeTime },
+  { "readTime_incremental", setupDefault, readTimeIncremental },
+  { "readTime_timeData", setupDefault, readTimeStruct },
+  { "writeTime_timeData", setupDefault, writeTimeStruct },
+  { "readTime_tm", setupDefault, readTimeTm },
+  { "writeTime_tm", setupDefault, writeTimeTm },
+  { "readEpoch", setupDefault, readEpoch },
+  { "writeEpoch", setupDefault, writeEpoch },
+  { "readSecs", setupDefault, readSecs },
+  { "readSnapshot", setupDefault, readSnapshot },
+  { "readTimeAsync", setupDefault, readTimeAsync },
+  { "writeTimeAsync", setupDefault, writeTimeAsync },
+  { "readAlarm1", setupDefault, readAlarm1 },
+  { "writeAlarm1", setupDefault, writeAlarm1 },
+  { "writeAlarm1_shadow", setupShadow, writeAlarm1 },
+  { "writeAlarm1Secs", setupDefault, writeAlarm1Secs },
+  { "setAlarm1Type", setupDefault, setAlarm1Type },
+  { "getAlarm1Type", setupDefault, getAlarm1Type },
+  { "checkAlarm1", setupDefault, checkAlarm1 },
+  { "readAlarm2", setupDefault, readAlarm2 },
+  { "writeAlarm2", setupDefault, writeAlarm2 },
+  { "writeAlarms", setupDefault, writeAlarms },
+  { "writeAlarms_shadow", setupShadow, writeAlarms },
+  { "setAlarm2Type", setupDefault, setAlarm2Type },
+  { "getAlarm2Type", setupDefault, getAlarm2Type },
+  { "checkAlarm2", setupDefault, checkAlarm2 },
+  { "serviceAlarms", setupDefault, serviceAlarms },
+  { "control", setupDefault, control },
+  { "control_shadow", setupShadow, control },
+  { "control_batch", setupDefault, controlBatch },
+  { "status", setupDefault, status },
+  { "status_shadow", setupShadow, status },
+  { "status_aging", setupDefault, statusAging },
+  { "readTempRegister", setupDefault, readTempRegister },
+  { "readTemperature", setupDefault, readTemperature },
+  { "pollConversion", setupDefault, pollConversion },
+  { "readRAM", setupDefault, readRAM },
+  { "writeRAM", setupDefault, writeRAM },
+  { "isRunning", setupDefault, isRunning },
+  // these change the control register and Alarm 1 so they run last
+  { "readTimeMs", setupSqw, readTimeMs },
+  { "writeTimeAligned", setupAligned, writeTimeAligned, ALIGNED_ITERATIONS },
+  { "scheduler_service", setupScheduler, schedulerService },
+};
+
+result_t result[ARRAY_SIZE(bench)];
+
+void runBench(const bench_t &b, result_t &r)
+{
+  uint32_t n = (b.iterations != 0) ? b.iterations : ITERATIONS;
+
+  b.setup();
+  b.run();      // warm up any caches
+  bus.reset();
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < n; i++)
+    b.run();
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+  r.name = b.name;
+  r.ns = std::chrono::duration<double, std::nano>(end - start).count() / n;
+  r.transactions = (double)bus.transactions() / n;
+  r.bytes = (double)bus.bytes() / n;
+}
+
+bool writeResults(const char *fileName)
+{
+  FILE *f = fopen(fileName, "w");
+
+  if (f == NULL)
+    return(false);
+
+  fprintf(f, "method,ns_per_op,transactions_per_op,bytes_per_op\n");
+  for (uint8_t i = 0; i < ARRAY_SIZE(result); i++)
+    fprintf(f, "%s,%.1f,%.2f,%.2f\n", result[i].name, result[i].ns, result[i].transactions, result[i].bytes);
+  fclose(f);
+
+  return(true);
+}
+
+int checkBaseline(const char *fileName)
+// Return the number of methods using more bus traffic than the baseline, -1 if error
+{
+  FILE *f = fopen(fileName, "r");
+  char line[128], name[64];
+  double ns, transactions, bytes;
+  int failed = 0;
+
+  if (f == NULL)
+    return(-1);
+
+  while (fgets(line, sizeof(line), f) != NULL)
+  {
+    if (sscanf(line, "%63[^,],%lf,%lf,%lf", name, &ns, &transactions, &bytes) != 4)
+      continue;   // header or malformed line
+
+    for (uint8_t i = 0; i < ARRAY_SIZE(result); i++)
+    {
+      if (strcmp(name, result[i].name) != 0)
+        continue;
+
+      if (result[i].transactions > transactions + 0.005 || result[i].bytes > bytes + 0.005)
+      {
+        printf("REGRESSION %s: %.2f transactions (baseline %.2f), %.2f bytes (baseline %.2f)\n",
+          name, result[i].transactions, transactions, result[i].bytes, bytes);
+        failed++;
+      }
+    }
+  }
+  fclose(f);
+
+  return(failed);
+}
+
+int main(int argc, char *argv[])
+{
+  const char *outFile = (argc > 1) ? argv[1] : "benchmark.csv";
+
+  // start with a valid time and both alarms set
+  RTC.writeTime(MD_DS3231::parseBuildTime("Oct 16 2026", "12:00:00"));
+  RTC.writeAlarm1(DS3231_ALM_DTHMS);
+  RTC.writeAlarm2(DS3231_ALM_HM);
+
+  printf("%-20s %10s %13s %10s\n", "method", "ns/op", "transactions", "bytes");
+  for (uint8_t i = 0; i < ARRAY_SIZE(bench); i++)
+  {
+    runBench(bench[i], result[i]);
+    printf("%-20s %10.1f %13.2f %10.2f\n", result[i].name, result[i].ns, result[i].transactions, result[i].bytes);
+  }
+
+  if (!writeResults(outFile))
+  {
+    printf("\nCannot write %s\n", outFile);
+    return(2);
+  }
+
+  if (argc > 2)
+  {
+    int failed = checkBaseline(argv[2]);
+
+    if (failed < 0)
+    {
+      printf("\nCannot read baseline %s\n", argv[2]);
+      return(2);
+    }
+    printf("\n%d regression(s) against %s\n", failed, argv[2]);
+    return(failed ? 1 : 0);
+  }
+
+  return(0);
+}
@@ -0,0 +1,166 @@
+// Host round trip test and benchmark for the MD_DS3231 epoch conversions
+//
+// Checks every date in the RTC range 2000-01-01 to 2199-12-31 against the C
+// library gmtime_r(), converts it back with daysFromCivil() and calcDoW(), and
+// writes and reads it through the in-memory register file transport with
+// writeEpoch64()/readEpoch64() and readSecs(), in 24 and 12 hour modes. It
+// then times the library conversions against mktime(), timegm() and gmtime_r().
+//
+// Build and run on Linux from this folder:
+//   g++ -std=gnu++11 -O2 -I../../src ../../src/*.cpp MD_DS3231_EpochBenchmark.cpp -o epochBenchmark -lpthread
+//   ./epochBenchmark
+//
+// The program prints each failed check and returns the number of failures.
+// Timing depends on the host and is reported for information only.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <chrono>
+#include <MD_DS3231.h>
+
+#define CHECK(c)  do { if (!(c)) { if (fails++ < 20) printf("FAIL line %d: %s\n", __LINE__, #c); } } while (0)
+
+const int32_t DAY_2000 = 10957;     // days from 1970-01-01 to 2000-01-01
+const int32_t DAY_2200 = 84006;     // days from 1970-01-01 to 2200-01-01
+const uint8_t PASSES = 20;          // times through the range for each benchmark
+
+MD_DS3231_BusMemory mem;
+MD_DS3231 RTC(mem);
+int fails = 0;
+volatile int64_t sink;              // keeps the benchmark loops from being optimized away
+
+int64_t timeOfDay(int32_t day)
+// A different time of day for each day, so all the time fields are exercised
+{
+  return(((int64_t)day * 7919) % 86400);
+}
+
+void roundTrip(boolean mode12)
+// Every date in the RTC range, converted both ways and through the device
+{
+  RTC.control(DS3231_12H, mode12 ? DS3231_ON : DS3231_OFF);
+
+  for (int32_t day = DAY_2000; day < DAY_2200; day++)
+  {
+    int64_t epoch = (int64_t)day * 86400 + timeOfDay(day), e;
+    time_t tt = (time_t)epoch;
+    struct tm ref, tm;
+    timeData_t t, u;
+
+    // date from days against the C library
+    gmtime_r(&tt, &ref);
+    MD_DS3231::civilFromDays(day, t);
+    CHECK(t.yyyy == ref.tm_year + 1900 && t.mm == ref.tm_mon + 1 && t.dd == ref.tm_mday);
+    CHECK(t.dow == ref.tm_wday + 1);
+
+    // and back again
+    CHECK(MD_DS3231::daysFromCivil(t.yyyy, t.mm, t.dd) == day);
+    CHECK(RTC.calcDoW(t.yyyy, t.mm, t.dd) == t.dow);
+    t.h = ref.tm_hour; t.m = ref.tm_min; t.s = ref.tm_sec; t.pm = 0;
+    MD_DS3231::time2tm(t, tm);
+    CHECK(tm.tm_wday == ref.tm_wday && tm.tm_yday == ref.tm_yday);
+    MD_DS3231::tm2Time(tm, u);
+    CHECK(u.yyyy == t.yyyy && u.mm == t.mm && u.dd == t.dd && u.h == t.h && u.m == t.m && u.s == t.s && u.dow == t.dow);
+    if (epoch - (int64_t)DAY_2000 * 86400 <= 0xffffffffLL)   // 32 bit seconds since 2000
+      CHECK(MD_DS3231::time2Secs(t) == (uint32_t)(epoch - (int64_t)DAY_2000 * 86400));
+
+    // through the device registers
+    CHECK(RTC.writeEpoch64(epoch));
+    CHECK(RTC.readEpoch64(e) && e == epoch);
+    CHECK(RTC.readTime(tm) && tm.tm_year == ref.tm_year && tm.tm_mon == ref.tm_mon && tm.tm_mday == ref.tm_mday &&
+      tm.tm_hour == ref.tm_hour && tm.tm_min == ref.tm_min && tm.tm_sec == ref.tm_sec && tm.tm_wday == ref.tm_wday);
+
+    // seconds since 2000 only for the years that fit in 32 bits
+    uint32_t secs;
+
+    if (t.yyyy <= 2135)
+      CHECK(RTC.readSecs(secs) && secs == MD_DS3231::time2Secs(t));
+    else
+      CHECK(!RTC.readSecs(secs) && !RTC.readRawSecs(secs));
+  }
+
+  // the ends of the range
+  CHECK(!RTC.writeEpoch64((int64_t)DAY_2000 * 86400 - 1));
+  CHECK(RTC.writeEpoch64((int64_t)DAY_2000 * 86400));
+  CHECK(RTC.writeEpoch64((int64_t)DAY_2200 * 86400 - 1));
+  CHECK(RTC.readTime() && RTC.yyyy == 2199 && RTC.mm == 12 && RTC.dd == 31 && RTC.m == 59 && RTC.s == 59);
+  CHECK(!RTC.writeEpoch64((int64_t)DAY_2200 * 86400));
+  CHECK(RTC.readTime() && RTC.yyyy == 2199);    // not changed
+}
+
+template <typename F> double timeRange(F f)
+// Average ns for f(day) over the RTC range
+{
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  for (uint8_t p = 0; p < PASSES; p++)
+    for (int32_t day = DAY_2000; day < DAY_2200; day++)
+      f(day);
+
+  std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+  return(std::chrono::duration<double, std::nano>(end - start).count() / (PASSES * (DAY_2200 - DAY_2000)));
+}
+
+void benchmark(void)
+{
+  setenv("TZ", "UTC", 1);   // mktime() works in local time
+  tzset();
+
+  printf("\n%-34s %10s\n", "date and time to epoch", "ns/op");
+  printf("%-34s %10.1f\n", "MD_DS3231::daysFromCivil()", timeRange([](int32_t day)
+  {
+    timeData_t t = { (uint16_t)(2000 + (day - DAY_2000) / 366), (uint8_t)(1 + day % 12), (uint8_t)(1 + day % 28), 12, 34, 56, 0, 0 };
+    sink += (((int64_t)MD_DS3231::daysFromCivil(t.yyyy, t.mm, t.dd) * 24 + t.h) * 60 + t.m) * 60 + t.s;
+  }));
+  printf("%-34s %10.1f\n", "timegm()", timeRange([](int32_t day)
+  {
+    struct tm tm = {};
+
+    tm.tm_sec = 56; tm.tm_min = 34; tm.tm_hour = 12;
+    tm.tm_mday = 1 + day % 28; tm.tm_mon = day % 12; tm.tm_year = 100 + (day - DAY_2000) / 366;
+    sink += timegm(&tm);
+  }));
+  printf("%-34s %10.1f\n", "mktime()", timeRange([](int32_t day)
+  {
+    struct tm tm = {};
+
+    tm.tm_sec = 56; tm.tm_min = 34; tm.tm_hour = 12;
+    tm.tm_mday = 1 + day % 28; tm.tm_mon = day % 12; tm.tm_year = 100 + (day - DAY_2000) / 366;
+    sink += mktime(&tm);
+  }));
+
+  printf("\n%-34s %10s\n", "epoch to date and time", "ns/op");
+  printf("%-34s %10.1f\n", "MD_DS3231::civilFromDays()", timeRange([](int32_t day)
+  {
+    int64_t epoch = (int64_t)day * 86400 + timeOfDay(day);
+    timeData_t t;
+
+    t.s = epoch % 60; t.m = (epoch / 60) % 60; t.h = (epoch / 3600) % 24;
+    MD_DS3231::civilFromDays(epoch / 86400, t);
+    sink += t.yyyy + t.mm + t.dd + t.h + t.m + t.s + t.dow;
+  }));
+  printf("%-34s %10.1f\n", "gmtime_r()", timeRange([](int32_t day)
+  {
+    time_t tt = (time_t)day * 86400 + timeOfDay(day);
+    struct tm tm;
+
+    gmtime_r(&tt, &tm);
+    sink += tm.tm_year + tm.tm_mon + tm.tm_mday + tm.tm_hour + tm.tm_min + tm.tm_sec + tm.tm_wday;
+  }));
+}
+
+int main(void)
+{
+  roundTrip(false);
+  roundTrip(true);
+  printf("Round trip 2000-2199: %s\n", fails ? "FAILED" : "OK");
+
+  benchmark();
+
+  if (fails)
+    printf("\nFAILED %d\n", fails);
+  return(fails);
+}
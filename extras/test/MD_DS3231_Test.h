@@ -0,0 +1,23 @@
+// Checks shared by the MD_DS3231 host tests
+//
+// CHECK() prints each failed condition with its line number and counts it.
+// testResult() prints the summary and returns the number of failures, for
+// the test to return from main().
+//
+
+#ifndef MD_DS3231_Test_h
+#define MD_DS3231_Test_h
+
+#include <stdio.h>
+
+static int fails = 0;     // failed checks
+
+#define CHECK(c)  do { if (!(c)) { printf("FAIL line %d: %s\n", __LINE__, #c); fails++; } } while (0)
+
+static inline int testResult(void)
+{
+  printf(fails ? "FAILED %d\n" : "ALL OK\n", fails);
+  return(fails);
+}
+
+#endif
@@ -0,0 +1,121 @@
+// Host test for the MD_DS3231 asynchronous transfers
+//
+// Runs the asynchronous methods against the in-memory register file
+// transport and checks that:
+// - the application loop keeps running while a transfer is in progress,
+// and the library does not use the bus until it has finished.
+// - each transfer reports its result once, to poll() and to the callback.
+// - two RTC objects sharing a transport each see their own result.
+//
+// Build and run with the other tests using "make check" in this folder.
+//
+
+#include <MD_DS3231.h>
+#include "MD_DS3231_Test.h"
+
+const uint8_t LATENCY = 5;    // polls for each simulated transfer
+
+MD_DS3231_BusMemory mem;
+MD_DS3231 RTC1(mem);
+MD_DS3231 RTC2(mem);
+
+asyncStatus_t cbStatus1, cbStatus2;
+uint8_t cbCount1, cbCount2;
+
+void cbAsync1(asyncStatus_t sts) { cbStatus1 = sts; cbCount1++; }
+void cbAsync2(asyncStatus_t sts) { cbStatus2 = sts; cbCount2++; }
+
+uint16_t loopUntilDone(MD_DS3231 &rtc, asyncStatus_t &sts)
+// Run a pretend application loop until the transfer ends, returning the loop count
+{
+  uint16_t loops = 0;
+
+  while ((sts = rtc.poll()) == DS3231_ASYNC_BUSY)
+  {
+    loops++;
+    CHECK(!rtc.readTime());   // bus is in use
+    if (loops > 1000) break;
+  }
+
+  return(loops);
+}
+
+void testLoop(void)
+// The loop keeps running during each type of transfer
+{
+  asyncStatus_t sts;
+  snapshot_t snap;
+
+  mem.setLatency(LATENCY);
+  cbCount1 = 0;
+
+  RTC1.yyyy = 2030; RTC1.mm = 6; RTC1.dd = 1; RTC1.h = 10; RTC1.m = 20; RTC1.s = 30; RTC1.dow = 7;
+  CHECK(RTC1.writeTimeAsync());
+  CHECK(!RTC1.writeTimeAsync());    // one transfer at a time
+  CHECK(loopUntilDone(RTC1, sts) == LATENCY - 1);
+  CHECK(sts == DS3231_ASYNC_DONE);
+  CHECK(cbCount1 == 1 && cbStatus1 == DS3231_ASYNC_DONE);
+  CHECK(RTC1.poll() == DS3231_ASYNC_IDLE);
+
+  RTC1.yyyy = RTC1.h = RTC1.m = 0;
+  CHECK(RTC1.readTimeAsync());
+  CHECK(RTC1.yyyy == 0);            // not updated until the transfer ends
+  CHECK(loopUntilDone(RTC1, sts) == LATENCY - 1);
+  CHECK(sts == DS3231_ASYNC_DONE);
+  CHECK(RTC1.yyyy == 2030 && RTC1.h == 10 && RTC1.m == 20);
+  CHECK(cbCount1 == 2 && cbStatus1 == DS3231_ASYNC_DONE);
+
+  CHECK(RTC1.readSnapshotAsync(snap));
+  CHECK(loopUntilDone(RTC1, sts) == LATENCY - 1);
+  CHECK(sts == DS3231_ASYNC_DONE);
+  CHECK(snap.time.yyyy == 2030 && snap.time.mm == 6 && snap.time.s == 30);
+  CHECK(cbCount1 == 3);
+
+  CHECK(RTC1.readTime());           // bus is free again
+}
+
+void testShared(uint8_t latency)
+// Two objects on the same transport each get their own result
+{
+  asyncStatus_t sts1, sts2;
+
+  mem.setLatency(latency);
+  cbCount1 = cbCount2 = 0;
+
+  CHECK(RTC1.readTimeAsync());
+  if (latency == 0)
+  {
+    // synchronous transport, both complete before they are polled
+    CHECK(RTC2.readTimeAsync());
+    CHECK(RTC1.poll() == DS3231_ASYNC_DONE);
+    CHECK(RTC2.poll() == DS3231_ASYNC_DONE);
+  }
+  else
+  {
+    // one simulated bus, so the second transfer waits for the first
+    CHECK(!RTC2.readTimeAsync());
+    CHECK(RTC2.poll() == DS3231_ASYNC_IDLE);
+    loopUntilDone(RTC1, sts1);
+    CHECK(sts1 == DS3231_ASYNC_DONE);
+    CHECK(RTC2.readTimeAsync());
+    CHECK(RTC1.poll() == DS3231_ASYNC_IDLE);
+    loopUntilDone(RTC2, sts2);
+    CHECK(sts2 == DS3231_ASYNC_DONE);
+  }
+
+  CHECK(cbCount1 == 1 && cbStatus1 == DS3231_ASYNC_DONE);
+  CHECK(cbCount2 == 1 && cbStatus2 == DS3231_ASYNC_DONE);
+  CHECK(RTC1.yyyy == 2030 && RTC2.yyyy == 2030);
+}
+
+int main(void)
+{
+  RTC1.setAsyncCallback(cbAsync1);
+  RTC2.setAsyncCallback(cbAsync2);
+
+  testLoop();
+  testShared(0);
+  testShared(LATENCY);
+
+  return(testResult());
+}
@@ -0,0 +1,172 @@
+// Host test for the add-on classes with a software time correction installed
+//
+// Runs MD_DS3231_Scheduler and MD_DS3231_AgingCal on the simulated device
+// with a correction set by setCorrection() and checks that:
+// - scheduled events run in the RTC second they are due, as Alarm 1 matches
+// the uncorrected RTC time, for negative, zero and positive corrections.
+// - the aging calibration measures the crystal error of the RTC and not the
+// residual error left by a correction that follows the drift.
+// The program supplies millis() and micros() so the simulated device runs on
+// a simulated clock instead of real time.
+//
+// Build and run with the other tests using "make check" in this folder.
+//
+
+#include <MD_DS3231.h>
+#include <MD_DS3231_Scheduler.h>
+#include <MD_DS3231_AgingCal.h>
+#include "MD_DS3231_Test.h"
+
+const uint32_t RUN_SECS = 60;       // seconds to run the scheduler for
+const int32_t CRYSTAL_PPB = 10000;  // crystal error for the aging calibration
+const uint16_t SCHED_STEP_MS = 100; // simulated time between calls to the scheduler service()
+const uint16_t CAL_STEP_MS = 10;    // simulated time between calls to the calibration service()
+
+MD_DS3231_BusSim sim;
+MD_DS3231 RTC(sim);
+
+uint32_t clockMs = 0;   // simulated host clock
+
+// Replace the host timer equivalents with the simulated clock
+unsigned long millis(void) { return(clockMs); }
+unsigned long micros(void) { return(clockMs * 1000UL); }
+
+// Correction by a fixed number of milliseconds
+class FixedCorrection : public MD_DS3231_Correction
+{
+  public:
+  FixedCorrection(int32_t ms) : _ms(ms) {};
+  virtual int32_t offsetMs(uint32_t rtcSecs) { (void)rtcSecs; return(_ms); };
+  virtual void timeWritten(uint32_t rtcSecs, uint32_t newSecs) { (void)rtcSecs; (void)newSecs; };
+
+  private:
+  int32_t _ms;
+};
+
+// Correction that removes a constant frequency error from start onwards
+class DriftCorrection : public MD_DS3231_Correction
+{
+  public:
+  DriftCorrection(uint32_t start, int32_t ms, int32_t ppb) : _start(start), _ms(ms), _ppb(ppb) {};
+  virtual int32_t offsetMs(uint32_t rtcSecs) { return(_ms - (int32_t)(((int64_t)(rtcSecs - _start) * _ppb) / 1000000)); };
+  virtual void timeWritten(uint32_t rtcSecs, uint32_t newSecs) { (void)rtcSecs; (void)newSecs; };
+
+  private:
+  uint32_t _start;
+  int32_t _ms;
+  int32_t _ppb;
+};
+
+// Reference clock that is exactly the simulated host clock
+class SimRef : public MD_DS3231_RefClock
+{
+  public:
+  virtual boolean read(uint32_t &ms) { ms = clockMs; return(true); };
+};
+
+typedef struct
+{
+  uint32_t due;     // RTC time the event is next due
+  uint32_t period;  // repeat period, 0 for one-shot
+  uint8_t runs;     // times the event ran
+  uint8_t wrong;    // times the event ran in the wrong second
+} eventLog_t;
+
+void logEvent(void *ctx)
+{
+  eventLog_t *e = (eventLog_t *)ctx;
+  uint32_t now;
+
+  if (!RTC.readRawSecs(now) || now != e->due)
+    e->wrong++;
+  e->runs++;
+  e->due += e->period;
+}
+
+void testScheduler(int32_t corrMs)
+{
+  schedEvent_t store[4];
+  MD_DS3231_Scheduler sched(RTC, store, 4);
+  FixedCorrection corr(corrMs);
+  uint32_t start, secs;
+
+  printf("scheduler: correction %ld ms\n", (long)corrMs);
+
+  RTC.setCorrection(&corr);
+  CHECK(RTC.readRawSecs(start) && RTC.readSecs(secs));
+  CHECK((int32_t)(secs - start) == corrMs / 1000);
+
+  eventLog_t once = { start + 10, 0, 0, 0 };
+  eventLog_t every = { start + 5, 7, 0, 0 };
+
+  CHECK(sched.begin());
+  CHECK(sched.add(once.due, logEvent, &once) != 0);
+  CHECK(sched.addRecurring(every.due, every.period, logEvent, &every) != 0);
+
+  for (uint32_t ms = 0; ms < RUN_SECS * 1000UL; ms += SCHED_STEP_MS)
+  {
+    clockMs += SCHED_STEP_MS;
+    sched.service();
+  }
+
+  CHECK(once.runs == 1 && once.wrong == 0);
+  CHECK(every.runs == 8 && every.wrong == 0);    // at 5, 12, ... 54 seconds
+  CHECK(sched.count() == 1);
+
+  RTC.setCorrection(nullptr);
+}
+
+int8_t aging(void)
+{
+  uint8_t v = 0;
+
+  RTC.readRAM(DS3231_AGING_REG, &v, 1);
+
+  return((int8_t)v);
+}
+
+void testAgingCal(void)
+{
+  SimRef ref;
+  MD_DS3231_AgingCal cal(RTC, ref);
+  uint32_t start, startMs;
+  boolean adjusted = false;
+
+  printf("aging calibration: crystal error %ld ppb\n", (long)CRYSTAL_PPB);
+
+  // the correction holds the time read within a second of the reference,
+  // and changes the seconds read part way through the window
+  sim.setFrequencyError(CRYSTAL_PPB);
+  CHECK(RTC.readRawSecs(start));
+  DriftCorrection corr(start, -480, CRYSTAL_PPB);
+  RTC.setCorrection(&corr);
+
+  cal.begin(60, 1);
+  startMs = clockMs;
+  while (!adjusted && clockMs - startMs < 2 * 3600000UL)
+  {
+    clockMs += CAL_STEP_MS;
+    adjusted = cal.service();
+  }
+
+  printf("  error %ld ppb, aging offset %d\n", (long)cal.lastError(), aging());
+  CHECK(adjusted);
+  CHECK(cal.lastError() > CRYSTAL_PPB - 1000 && cal.lastError() < CRYSTAL_PPB + 1000);
+  CHECK(aging() >= CRYSTAL_PPB / AGINGCAL_STEP_PPB - 10 && aging() <= CRYSTAL_PPB / AGINGCAL_STEP_PPB + 10);
+
+  RTC.setCorrection(nullptr);
+}
+
+int main(void)
+{
+  timeData_t t = { 2026, 10, 16, 12, 0, 0, 6, 0 };
+
+  CHECK(RTC.writeTime(t));
+
+  testScheduler(-5000);
+  testScheduler(0);
+  testScheduler(5000);
+  testAgingCal();
+
+  return(testResult());
+}
@@ -0,0 +1,50 @@
+// Host test for the MD_DS3231 fast software clock
+//
+// Runs now() against the in-memory register file transport and checks the
+// clock follows the square wave edges past the point where a 16 bit edge
+// counter would wrap.
+//
+// Build and run with the other tests using "make check" in this folder.
+//
+
+#include <MD_DS3231.h>
+#include "MD_DS3231_Test.h"
+
+const uint32_t EDGES = 70000UL;   // more than a 16 bit counter holds
+const uint32_t STEP = 1000;       // edges between calls to now()
+
+MD_DS3231_BusMemory mem;
+MD_DS3231 RTC(mem);
+
+uint32_t nowSecs(void)
+// Seconds from the start of the first day, the test runs into the next day
+{
+  return((RTC.dd - 16) * 86400UL + RTC.h * 3600UL + RTC.m * 60UL + RTC.s);
+}
+
+int main(void)
+{
+  uint32_t start;
+
+  RTC.yyyy = 2026; RTC.mm = 10; RTC.dd = 16;
+  RTC.h = 12; RTC.m = 0; RTC.s = 0; RTC.dow = 6;
+  CHECK(RTC.writeTime());
+  RTC.setFastClock(true);
+  RTC.now();      // set the clock from the RTC
+  start = nowSecs();
+  CHECK(start == 12 * 3600UL);
+
+  for (uint32_t i = 0; i < EDGES; i += STEP)
+  {
+    for (uint32_t j = 0; j < STEP; j++)
+      RTC.sqwEdge();
+    RTC.now();
+    CHECK(nowSecs() - start == i + STEP);
+  }
+
+  // the RTC is not read again, so the fast clock is still counting edges
+  RTC.now();
+  CHECK(nowSecs() - start == EDGES);
+
+  return(testResult());
+}
@@ -0,0 +1,102 @@
+// Host test for multiple MD_DS3231 instances used from several threads
+//
+// Each thread drives its own RTC object. All the objects share one
+// in-memory transport behind a simulated I2C multiplexer, with a separate
+// register file on each channel. Every thread writes and reads back its
+// own time and RAM, synchronously and asynchronously, and checks it never
+// sees another thread's data.
+//
+// Build and run with the other tests using "make check" in this folder.
+//
+
+#include <thread>
+#include <atomic>
+#include <MD_DS3231.h>
+#include "MD_DS3231_Test.h"
+
+const uint8_t INSTANCES = 8;        // RTC objects, one per thread and mux channel
+const uint32_t ITERATIONS = 100000;  // test cycles per thread
+
+// In-memory transport with one register file per multiplexer channel
+class MuxMemory : public MD_DS3231_BusMemory
+{
+  public:
+  MuxMemory(void) : _channel(0) { memset(_bank, 0, sizeof(_bank)); };
+  void select(uint8_t channel) { _channel = channel; };
+  uint8_t bank(uint8_t channel, uint8_t addr) { return(_bank[channel][addr]); };
+
+  protected:
+  virtual uint8_t readRegister(uint8_t addr) { return(_bank[_channel][addr]); };
+  virtual void writeRegister(uint8_t addr, uint8_t value) { _bank[_channel][addr] = value; };
+
+  private:
+  uint8_t _channel;
+  uint8_t _bank[INSTANCES][DS3231_RAM_MAX];
+};
+
+MuxMemory mem;
+std::atomic<int> errors(0);
+
+void muxSelect(void *ctx, uint8_t channel) { ((MuxMemory *)ctx)->select(channel); }
+
+void runInstance(MD_DS3231 *rtc, uint8_t id)
+{
+  uint8_t ram[2];
+
+  for (uint32_t i = 0; i < ITERATIONS; i++)
+  {
+    uint8_t m = i % 60;
+    asyncStatus_t sts;
+
+    // synchronous write and read back
+    rtc->yyyy = 2000 + id; rtc->mm = 1 + id; rtc->dd = 1 + id;
+    rtc->h = id; rtc->m = m; rtc->s = id; rtc->dow = 1;
+    if (!rtc->writeTime()) errors++;
+    rtc->yyyy = rtc->m = 0;
+    if (!rtc->readTime() || rtc->yyyy != 2000 + id || rtc->m != m || rtc->h != id) errors++;
+
+    // asynchronous read back, in the object's own buffers
+    rtc->yyyy = rtc->m = 0;
+    if (!rtc->readTimeAsync()) errors++;
+    while ((sts = rtc->poll()) == DS3231_ASYNC_BUSY)
+      std::this_thread::yield();
+    if (sts != DS3231_ASYNC_DONE || rtc->yyyy != 2000 + id || rtc->m != m || rtc->dd != 1 + id) errors++;
+
+    // alarm registers as RAM
+    ram[0] = id; ram[1] = m;
+    if (rtc->writeRAM(0x07, ram, 2) != 2) errors++;
+    ram[0] = ram[1] = 0xff;
+    if (rtc->readRAM(0x07, ram, 2) != 2 || ram[0] != id || ram[1] != m) errors++;
+  }
+}
+
+int main(void)
+{
+  MD_DS3231 *rtc[INSTANCES];
+  std::thread th[INSTANCES];
+
+  for (uint8_t i = 0; i < INSTANCES; i++)
+  {
+    rtc[i] = new MD_DS3231(mem);
+    rtc[i]->setMuxCallback(muxSelect, &mem, i);
+    CHECK(rtc[i]->control(DS3231_12H, DS3231_OFF));
+  }
+
+  for (uint8_t i = 0; i < INSTANCES; i++)
+    th[i] = std::thread(runInstance, rtc[i], i);
+  for (uint8_t i = 0; i < INSTANCES; i++)
+    th[i].join();
+
+  CHECK(errors == 0);
+  if (errors != 0) printf("%d errors\n", (int)errors);
+
+  // each channel holds its own thread's data
+  for (uint8_t i = 0; i < INSTANCES; i++)
+  {
+    CHECK(mem.bank(i, 0x07) == i);
+    CHECK((mem.bank(i, 0x05) & 0x1f) == 1 + i);   // months 1-8 are the same in BCD
+    delete rtc[i];
+  }
+
+  return(testResult());
+}
@@ -0,0 +1,167 @@
+// Host test for MD_DS3231_Slew
+//
+// Slews the time of the simulated device in each slewMode_t and checks the
+// seconds read never step on by more than one or go backwards, the correction
+// is made within the period and the aging offset is restored at the end.
+// The program supplies millis() and micros() so the simulated device and the
+// slew service() run on a simulated clock instead of real time.
+//
+// Build and run with the other tests using "make check" in this folder.
+//
+
+#include <MD_DS3231.h>
+#include <MD_DS3231_Slew.h>
+#include "MD_DS3231_Test.h"
+
+const int8_t BASE_AGING = 5;          // aging offset before each slew
+const int32_t CRYSTAL_PPB = 500;      // crystal error, cancelled by BASE_AGING
+
+MD_DS3231_BusSim sim;
+MD_DS3231 RTC(sim);
+MD_DS3231_Slew slew(RTC);
+
+uint32_t clockMs = 0;   // simulated host clock
+
+// Replace the host timer equivalents with the simulated clock
+unsigned long millis(void) { return(clockMs); }
+unsigned long micros(void) { return(clockMs * 1000UL); }
+
+int8_t aging(void)
+{
+  uint8_t v = 0;
+
+  RTC.readRAM(DS3231_AGING_REG, &v, 1);
+
+  return((int8_t)v);
+}
+
+int32_t frequencyError(void)
+// The simulated device catches up with the clock on the next transfer
+{
+  RTC.isRunning();
+
+  return(sim.frequencyError());
+}
+
+void slewTest(const char *name, int32_t offsetMs, uint32_t period, slewMode_t mode, uint16_t stepMs)
+// Slew and check the time read every stepMs until the end of the period
+{
+  uint32_t vis0, vis, last, raw0, raw1;
+  uint32_t startMs, elapsed;
+  int back = 0, skip = 0, alarms = 0, expect = 0;
+
+  printf("%s: %ld ms over %lu s\n", name, (long)offsetMs, (unsigned long)period);
+
+  RTC.checkAlarm1();    // clear the flag
+  CHECK(RTC.readRawSecs(raw0));
+  CHECK(RTC.readSecs(vis0));
+  startMs = clockMs;
+  last = vis0;
+
+  CHECK(slew.start(offsetMs, period, mode));
+  CHECK(slew.active());
+  if (mode == SLEW_SOFTWARE)
+    CHECK(aging() == BASE_AGING);
+  else
+    CHECK(aging() != BASE_AGING);
+
+  // run to the end of the period, allowing one check interval for service()
+  while (clockMs - startMs < period * 1000UL + SLEW_CHECK_MS)
+  {
+    clockMs += stepMs;
+    slew.service();
+
+    if (!RTC.readSecs(vis))
+    {
+      CHECK(false);
+      break;
+    }
+    if ((int32_t)(vis - last) < 0) back++;
+    if ((int32_t)(vis - last) > 1) skip++;
+    last = vis;
+
+    if (RTC.checkAlarm1()) alarms++;
+  }
+  elapsed = clockMs - startMs;
+
+  CHECK(back == 0);
+  CHECK(skip == 0);
+  CHECK(!slew.active());
+
+  // the correction has been made, to the resolution of the seconds
+  int32_t err = (int32_t)((int64_t)(vis - vis0) * 1000 - elapsed - offsetMs);
+
+  printf("  corrected by %ld ms, error %ld ms\n", (long)(offsetMs + err), (long)err);
+  CHECK(err > -1500 && err < 1500);
+
+  // aging offset restored, once the conversion it started is done
+  clockMs += 1000;
+  CHECK(aging() == BASE_AGING);
+  CHECK(frequencyError() == 0);
+
+  // the RTC time moved smoothly, so the alarm matched once each minute
+  CHECK(RTC.readRawSecs(raw1));
+  for (uint32_t s = raw0 + 1; s <= raw1; s++)
+    if (s % 60 == 30) expect++;
+  CHECK(alarms == expect || alarms == expect - 1);   // the last can be after the loop
+}
+
+int main(void)
+{
+  timeData_t t = { 2026, 10, 16, 12, 0, 0, 6, 0 };
+
+  // time set, alarm each minute at 30 seconds and the crystal error trimmed out
+  RTC.writeTime(t);
+  RTC.s = 30;
+  RTC.writeAlarm1(DS3231_ALM_S);
+  sim.setFrequencyError(CRYSTAL_PPB);
+  RTC.control(DS3231_AGING_OFFSET, (uint8_t)BASE_AGING);
+  RTC.startConversion();
+  clockMs += 500;
+  CHECK(frequencyError() == 0);
+
+  slew.begin();
+
+  // the aging offset can slew about 1 second a day, software up to SLEW_MAX_PPM
+  slewTest("aging forward", 1000, 86400, SLEW_AGING, 500);
+  slewTest("aging back", -1000, 86400, SLEW_AGING, 500);
+  slewTest("software back", -5000, 14400, SLEW_SOFTWARE, 250);
+  CHECK(slew.offset() == -5000);
+  slewTest("software forward", 5000, 14400, SLEW_SOFTWARE, 250);
+  CHECK(slew.offset() == 0);
+  slewTest("both forward", 3000, 7200, SLEW_BOTH, 500);
+  CHECK(slew.offset() > 0);     // more than the aging offset can do
+  slewTest("both back", -3000, 7200, SLEW_BOTH, 500);
+
+  // writing the time clears the software correction
+  uint32_t raw, secs;
+
+  RTC.writeTime(t);
+  CHECK(RTC.readRawSecs(raw) && RTC.readSecs(secs) && raw == secs);
+  CHECK(slew.offset() == 0);
+
+  // writing the time during an aging slew cancels it at the next service()
+  CHECK(slew.start(-1000, 86400, SLEW_AGING));
+  CHECK(aging() == BASE_AGING + 116);   // 11.6ppm slower
+  RTC.writeTime(t);
+  slew.service();
+  CHECK(aging() == BASE_AGING);
+  CHECK(!slew.active());
+
+  // corrections faster than SLEW_MAX_PPM or out of range are rejected
+  CHECK(!slew.start(INT32_MIN, 100));
+  CHECK(!slew.start(INT32_MIN, 0xffffffffUL));
+  CHECK(!slew.start(INT32_MAX, 100));
+  CHECK(!slew.start(51, 100));
+  CHECK(!slew.start(-51, 100));
+  CHECK(!slew.start(1000, 0));
+  CHECK(slew.start(-50, 100, SLEW_SOFTWARE));
+  CHECK(slew.stop());
+
+  // the aging offset cannot go any further
+  RTC.control(DS3231_AGING_OFFSET, 0x80);
+  CHECK(!slew.start(1000, 3600, SLEW_AGING));
+  RTC.control(DS3231_AGING_OFFSET, (uint8_t)BASE_AGING);
+
+  return(testResult());
+}
@@ -8,18 +8,76 @@
   License as published by the Free Software Foundation; either
   version 2.1 of the License, or (at your option) any later version.
  */
-#include <Wire.h>
 #include "MD_DS3231.h"
+#include "MD_DS3231_BCD.h"
+
+#ifdef ARDUINO
+static MD_DS3231_BusWire defaultBus(Wire); // default transport for the Arduino Wire library
+#endif
 
 #if ENABLE_RTC_INSTANCE
 class MD_DS3231 RTC;  // one instance created when library is included
 #endif
 
 // Useful definitions
-#define DS3231_ID ((uint8_t)0x68)  // I2C/TWI device address, coded into the device
-
 #define RAM_BASE_READ 0 // smallest read address
 
+// Epoch conversions
+#define EPOCH_DAYS_2000 10957UL       // days from 1970-01-01 to 2000-01-01
+#define EPOCH_SECS_2000 946684800UL   // seconds from 1970-01-01 to 2000-01-01
+#define EPOCH_SECS_2200 7258118400LL  // seconds from 1970-01-01 to 2200-01-01, the end of the RTC range
+#define EPOCH_MAX_YEAR  2105          // last full year of 32 bit unsigned Unix time
+#define SECS_MAX_YEAR   2135          // last full year of 32 bit unsigned seconds since 2000
+
+// Masks for the value bits of the time registers, 24H and 12H modes
+static const uint8_t timeMask24[8] = { 0x7f, 0x7f, 0x3f, 0x07, 0x3f, 0x1f, 0xff, 0x00 };
+static const uint8_t timeMask12[8] = { 0x7f, 0x7f, 0x1f, 0x07, 0x3f, 0x1f, 0xff, 0x00 };
+
+static inline void decodeBCD(const uint8_t *in, uint8_t *out, const uint8_t *mask)
+// Convert the 7 byte BCD time block to binary in an 8 byte buffer,
+// discarding the control bits using the mask.
+{
+#if ENABLE_SWAR_BCD
+  decodeBCDWords(in, out, mask);
+#else
+  decodeBCDBytes(in, out, mask);
+#endif
+}
+
+static inline void encodeBCD(const uint8_t *in, uint8_t *out)
+// Convert the binary time block in an 8 byte buffer to 7 BCD bytes
+{
+#if ENABLE_SWAR_BCD
+  encodeBCDWords(in, out);
+#else
+  encodeBCDBytes(in, out);
+#endif
+}
+
+// Compile time checks of the constexpr date and time functions
+static_assert(MD_DS3231::BCD2bin(0x00) == 0 && MD_DS3231::BCD2bin(0x59) == 59 && MD_DS3231::BCD2bin(0x99) == 99, "BCD2bin");
+static_assert(MD_DS3231::bin2BCD(0) == 0x00 && MD_DS3231::bin2BCD(59) == 0x59 && MD_DS3231::bin2BCD(99) == 0x99, "bin2BCD");
+static_assert(MD_DS3231::isLeapYear(2000) && MD_DS3231::isLeapYear(2024) && !MD_DS3231::isLeapYear(2100) && !MD_DS3231::isLeapYear(2023), "isLeapYear");
+static_assert(MD_DS3231::daysInMonth(2024, 2) == 29 && MD_DS3231::daysInMonth(2100, 2) == 28 && MD_DS3231::daysInMonth(2000, 2) == 29, "daysInMonth February");
+static_assert(MD_DS3231::daysInMonth(2023, 1) == 31 && MD_DS3231::daysInMonth(2023, 4) == 30 && MD_DS3231::daysInMonth(2023, 7) == 31 &&
+              MD_DS3231::daysInMonth(2023, 8) == 31 && MD_DS3231::daysInMonth(2023, 11) == 30 && MD_DS3231::daysInMonth(2023, 12) == 31, "daysInMonth");
+static_assert(MD_DS3231::calcDoW(2000, 1, 1) == 7 && MD_DS3231::calcDoW(2000, 2, 29) == 3 && MD_DS3231::calcDoW(2000, 3, 1) == 4, "calcDoW 2000");
+static_assert(MD_DS3231::calcDoW(1970, 1, 1) == 5 && MD_DS3231::calcDoW(2100, 3, 1) == 2 && MD_DS3231::calcDoW(2199, 12, 31) == 3, "calcDoW");
+static_assert(MD_DS3231::daysFromCivil(1970, 1, 1) == 0 && MD_DS3231::daysFromCivil(2000, 1, 1) == EPOCH_DAYS_2000, "daysFromCivil epoch");
+static_assert(MD_DS3231::daysFromCivil(2000, 3, 1) - MD_DS3231::daysFromCivil(2000, 2, 28) == 2 &&
+              MD_DS3231::daysFromCivil(2100, 3, 1) - MD_DS3231::daysFromCivil(2100, 2, 28) == 1, "daysFromCivil leap day");
+static_assert(MD_DS3231::time2Epoch(timeData_t{ 2000, 1, 1, 0, 0, 0, 7, 0 }) == EPOCH_SECS_2000, "time2Epoch 2000");
+static_assert(MD_DS3231::time2Epoch(timeData_t{ 2038, 1, 19, 3, 14, 8, 3, 0 }) == 0x80000000UL, "time2Epoch 2038");
+static_assert(MD_DS3231::time2Epoch(timeData_t{ 2106, 2, 7, 6, 28, 15, 1, 0 }) == 0xffffffffUL, "time2Epoch 2106");
+static_assert(MD_DS3231::daysFromCivil(2200, 1, 1) * 86400LL == EPOCH_SECS_2200, "daysFromCivil 2200");
+static_assert(MD_DS3231::time2Secs(timeData_t{ 2000, 1, 1, 0, 0, 1, 7, 0 }) == 1, "time2Secs");
+static_assert(MD_DS3231::parseBuildTime("Jan  1 2000", "00:00:00").dd == 1 && MD_DS3231::parseBuildTime("Jan  1 2000", "00:00:00").dow == 7, "parseBuildTime date");
+static_assert(MD_DS3231::parseBuildTime("Feb 29 2024", "23:59:58").mm == 2 && MD_DS3231::parseBuildTime("Feb 29 2024", "23:59:58").s == 58, "parseBuildTime time");
+static_assert(MD_DS3231::parseBuildTime("Jun 15 2025", "12:00:00").mm == 6 && MD_DS3231::parseBuildTime("Jul 15 2025", "12:00:00").mm == 7 &&
+              MD_DS3231::parseBuildTime("Mar 15 2025", "12:00:00").mm == 3 && MD_DS3231::parseBuildTime("May 15 2025", "12:00:00").mm == 5 &&
+              MD_DS3231::parseBuildTime("Apr 15 2025", "12:00:00").mm == 4 && MD_DS3231::parseBuildTime("Aug 15 2025", "12:00:00").mm == 8 &&
+              MD_DS3231::parseBuildTime("Dec 31 2199", "12:00:00").yyyy == 2199, "parseBuildTime month");
+
 // Addresses for the parts of the date/time in RAM
 #define ADDR_SEC    ((uint8_t)0x0)
 #define ADDR_MIN    ((uint8_t)0x1)
@@ -47,7 +105,7 @@ class MD_DS3231 RTC;  // one instance created when library is included
 
 #define ADDR_CONTROL_REGISTER 0x0e
 #define ADDR_STATUS_REGISTER  0x0f
-#define ADDR_AGING_REGISTER   0x10
+#define ADDR_AGING_REGISTER   DS3231_AGING_REG
 #define ADDR_TEMP_REGISTER    0x11
 
 // Bit masks for the control/testable bits
@@ -66,381 +124,1665 @@ class MD_DS3231 RTC;  // one instance created when library is included
 #define STS_A2F   0x02  // Alarm 2 Flag - bit 1 status register
 #define STS_A1F   0x01  // Alarm 1 Flag - bit 0 status register
 
-// Define a global buffer we can use in these functions
-#define MAX_BUF   8     // time message is the biggest message we need to handle (7 bytes)
-uint8_t bufRTC[MAX_BUF];
-#define CLEAR_BUFFER  { memset(bufRTC, 0, sizeof(bufRTC)); }
+#if ENABLE_SHADOW_CACHE
+// Register bits that only change when written by the library and can be 
+// served from the shadow cache. Bits not in the mask are always read from the device.
+static const uint8_t shadowStable[DS3231_RAM_MAX] PROGMEM =
+{
+  0x00, 0x00, CTL_12H, 0x00, 0x00, 0x00, 0x00, // time
+  0xff, 0xff, 0xff, 0xff,                       // alarm 1
+  0xff, 0xff, 0xff,                             // alarm 2
+  (uint8_t)~CTL_CONV,                           // control
+  STS_EN32KHZ,                                  // status
+  0xff,                                         // aging
+  0x00, 0x00                                    // temperature
+};
+#endif
+
+#define ALIGN_PREPARE_US 5000UL  // time allowed to pack the time before an aligned write
+
+#define SQW_TIMEOUT_US(rate) ((2000000UL / (rate)) + 20000UL)  // no square wave edges for this long means they have stopped
+
+#define CLEAR_BUFFER  { memset(_bufRTC, 0, sizeof(_bufRTC)); }
 
 #define DEFAULT_CENTURY 20 // Default century used to compute the yyyy interface register
 
-#if ENABLE_CENTURY
+#if ENABLE_DYNAMIC_CENTURY
 #define CENTURY _century
 #else
 #define CENTURY DEFAULT_CENTURY
 #endif
 
 
-// Interface functions for the RTC device
-uint8_t MD_DS3231::readDevice(uint8_t addr, uint8_t* buf, uint8_t len)
+static boolean statusLocation(codeRequest_t item, uint8_t &addr, uint8_t &mask);
+static codeStatus_t statusDecode(codeRequest_t item, uint8_t mask, uint8_t value);
+
+static uint16_t sqwRate(uint8_t ctl)
+// Square wave edges per second for the control register value, 0 if none
 {
-  Wire.beginTransmission(DS3231_ID);
-  Wire.write(addr);       // set register address
-  if (Wire.endTransmission() != 0)
+  if (ctl & CTL_INTCN)
     return(0);
 
-  Wire.requestFrom(DS3231_ID, len);
-  //while (!Wire.available()) ;   // wait
-  for (uint8_t i=0; i<len; i++) // Read x data from given address upwards...
+  switch (ctl & CTL_RS)
+  {
+    case (0x00 << 3): return(1);
+    case (0x01 << 3): return(1024);
+    case (0x02 << 3): return(4096);
+    default:          return(8192);
+  }
+}
+
+static inline boolean timeMode12(const uint8_t *buf)
+// true if the time registers in buf are in 12H mode
+{
+#if ENABLE_12H
+  return((buf[ADDR_CTL_12H] & CTL_12H) != 0);
+#else
+  return(false);
+#endif
+}
+
+int16_t MD_DS3231::tempDecode(const uint8_t *buf)
+// Convert the temperature register pair in buf to quarter degrees C.
+// The MSB is the two's complement integer part, the top 2 bits of the LSB the fraction.
+{
+  return(((int16_t)(int8_t)buf[0] * 4) + (buf[1] >> 6));
+}
+
+// Interface functions for the RTC device
+#if ENABLE_SHADOW_CACHE
+void MD_DS3231::updateShadow(uint8_t addr, uint8_t* buf, uint8_t len)
+// Copy the registers just read or written into the shadow cache
+{
+  if (!_shadowEnabled)
+    return;
+
+  for (uint8_t i = 0; i < len && addr + i < DS3231_RAM_MAX; i++)
+  {
+    _shadow[addr + i] = buf[i];
+    _shadowValid |= (1UL << (addr + i));
+  }
+}
+#endif
+
+void MD_DS3231::busStart(void)
+// Take ownership of the bus and route it to this device
+{
+  _bus.lock();
+  if (_cbMux != nullptr) _cbMux(_muxCtx, _muxChannel);
+}
+
+boolean MD_DS3231::readRegister(uint8_t addr, uint8_t need, uint8_t &value)
+// Read one register where only the bits in need are of interest. 
+// Use the shadow cache if it holds all the bits needed.
+{
+#if ENABLE_SHADOW_CACHE
+  if (_shadowEnabled && (_shadowValid & (1UL << addr)))
   {
-    buf[i] = Wire.read();       // ... and store it in the buffer
+    uint8_t stable = pgm_read_byte(&shadowStable[addr]);
+
+    if ((need & ~stable) == 0)
+    {
+      value = _shadow[addr] & stable;
+      return(true);
+    }
   }
+#endif
+
+  return(readDevice(addr, &value, 1) == 1);
+}
+
+uint8_t MD_DS3231::readDevice(uint8_t addr, uint8_t* buf, uint8_t len)
+{
+  if (_asyncOp != ASYNC_NONE)   // bus is in use for an asynchronous transfer
+    return(0);
+
+  // set register address and read x data from that address upwards
+  busStart();
+  uint8_t n = _bus.transaction(_addr, &addr, 1, buf, len);
+  _bus.unlock();
+
+  if (n != len)
+    return(0);
+
+#if ENABLE_SHADOW_CACHE
+  updateShadow(addr, buf, len);
+#endif
+  if (_corr != nullptr && addr == ADDR_TIME && len >= 7)
+    noteTimeRead(buf);
 
   return(len);
 }
 
 uint8_t MD_DS3231::writeDevice(uint8_t addr, uint8_t* buf, uint8_t len)
 {
-  Wire.beginTransmission(DS3231_ID);
-  Wire.write(addr);       // set register address 
-  Wire.write(buf, len);   // ... and send it from buffer                 
-  Wire.endTransmission();
+  uint8_t msg[DS3231_RAM_MAX + 1];
+
+  if (len > DS3231_RAM_MAX || _asyncOp != ASYNC_NONE)
+    return(0);
+
+  msg[0] = addr;            // set register address ...
+  memcpy(&msg[1], buf, len);// ... followed by the data
+
+  busStart();
+  uint8_t n = _bus.write(_addr, msg, len + 1);
+  _bus.unlock();
+
+  if (n != len + 1)
+    return(0);
+
+  if (addr <= ADDR_YR)    // time changed, next incremental or millisecond read must start again
+    _incValid = _msValid = false;
+  if (addr <= ADDR_CONTROL_REGISTER && addr + len > ADDR_CONTROL_REGISTER &&
+      sqwRate(buf[ADDR_CONTROL_REGISTER - addr]) != _msRate)
+    _msValid = false;     // square wave changed
+#if ENABLE_SHADOW_CACHE
+  updateShadow(addr, buf, len);
+#endif
 
   return(len);
 }
 
 // Class functions
+void MD_DS3231::init(void)
+// Common initialization for all the constructors
+{
+#if ENABLE_SHADOW_CACHE
+  _shadowEnabled = false;
+  _shadowValid = 0;
+#endif
+  _batch = false;
+  _batchMask[0] = _batchMask[1] = 0;
+  _batchCmd[0] = _batchCmd[1] = 0;
+  _asyncOp = ASYNC_NONE;
+  _asyncSts = DS3231_ASYNC_IDLE;
+  _asyncSnap = nullptr;
+  _cbAsync = nullptr;
+  _cbMux = nullptr;
+  _muxCtx = nullptr;
+  _muxChannel = 0;
+  _cbAlarm1Ctx = _cbAlarm2Ctx = nullptr;
+  _ctxAlarm1 = _ctxAlarm2 = nullptr;
+  _almIntMode = _almPending = false;
+  _fastEnabled = _fastValid = _fastMode12 = false;
+  _fastResync = 0;
+  _fastAnchorMs = _fastMs = _fastEdges = 0;
+  _fastSqw = false;
+  _incValid = false;
+  _incRefresh = 0;
+  _incReadMs = _incFullMs = 0;
+  memset(&_incTime, 0, sizeof(_incTime));
+  memset(&_incShown, 0, sizeof(_incShown));
+  _incMode12 = false;
+  _corr = nullptr;
+  _readValid = false;
+  _readSecs = _readMs = 0;
+  _alignLatency = _lastLatency = 0;
+  _sqwCount = _sqwUs = 0;
+  _msValid = false;
+  _msRate = 1;
+  _msEdges = _msSecs = 0;
+  for (uint8_t i = 0; i < TCB_MAX; i++)
+  {
+    _cbTime[i] = nullptr;
+    _ctxTime[i] = nullptr;
+  }
+}
+
+MD_DS3231::MD_DS3231(MD_DS3231_Bus &bus, uint8_t addr) : yyyy(0), mm(0), dd(0), h(0), m(0), s(0), 
+#if ENABLE_DOW
+dow(0),
+#endif
+_bus(bus), _addr(addr), _cbAlarm1(nullptr), _cbAlarm2(nullptr)
+#if ENABLE_DYNAMIC_CENTURY
+, _century(DEFAULT_CENTURY)
+#endif
+{
+  init();
+  _bus.begin();
+}
+
+#ifdef ARDUINO
 MD_DS3231::MD_DS3231() : yyyy(0), mm(0), dd(0), h(0), m(0), s(0), 
 #if ENABLE_DOW
 dow(0),
 #endif
-_cbAlarm1(nullptr), _cbAlarm2(nullptr),
+_bus(defaultBus), _addr(DS3231_ID), _cbAlarm1(nullptr), _cbAlarm2(nullptr)
 #if ENABLE_DYNAMIC_CENTURY
-_century(DEFAULT_CENTURY)
+, _century(DEFAULT_CENTURY)
 #endif
 {
-  Wire.begin();
+  init();
+  Wire.begin();   // not through defaultBus as this may run before it is constructed
 }
+#endif
 
 #ifdef ESP8266
 MD_DS3231::MD_DS3231(int sda, int scl) : yyyy(0), mm(0), dd(0), h(0), m(0), s(0), 
 #if ENABLE_DOW
 dow(0),
 #endif
+_bus(defaultBus), _addr(DS3231_ID), _cbAlarm1(nullptr), _cbAlarm2(nullptr)
 #if ENABLE_DYNAMIC_CENTURY
-_century(DEFAULT_CENTURY),
+, _century(DEFAULT_CENTURY)
+#endif
+{
+  init();
+  Wire.begin(sda, scl);
+}
+#endif
+
+boolean MD_DS3231::checkAlarm1(void)
+// Check the alarm. If time happened then call the callback function and reset the flag
+{
+  boolean b = (status(DS3231_A1_FLAG) == DS3231_ON);
+
+  if (b)
+  {
+    control(DS3231_A1_FLAG, DS3231_OFF);
+    dispatchAlarm(1);
+  }    
+
+  return(b);
+}
+
+boolean MD_DS3231::checkAlarm2(void)
+// Check the alarm. If time happened then call the callback function and reset the flag
+{
+  boolean b = (status(DS3231_A2_FLAG) == DS3231_ON);
+
+  if (b)
+  {
+    control(DS3231_A2_FLAG, DS3231_OFF);
+    dispatchAlarm(2);
+  }
+
+  return(b);
+}
+
+void MD_DS3231::dispatchAlarm(uint8_t alarm)
+// Invoke the callback functions for the alarm
+{
+  if (alarm == 1)
+  {
+    if (_cbAlarm1 != nullptr) _cbAlarm1();
+    if (_cbAlarm1Ctx != nullptr) _cbAlarm1Ctx(_ctxAlarm1);
+  }
+  else
+  {
+    if (_cbAlarm2 != nullptr) _cbAlarm2();
+    if (_cbAlarm2Ctx != nullptr) _cbAlarm2Ctx(_ctxAlarm2);
+  }
+}
+
+uint8_t MD_DS3231::serviceAlarms(void)
+// Check both alarms with one status read, clear the flags that are set 
+// with one write and then invoke the callbacks.
+{
+  uint8_t fired;
+
+  if (_almIntMode && !_almPending)
+    return(0);
+
+  _almPending = false;    // an interrupt from here on needs another service
+
+  if (readDevice(ADDR_STATUS_REGISTER, _bufRTC, 1) != 1)
+  {
+    _almPending = true;   // flags not checked, try again next time
+    return(0);
+  }
+
+  fired = _bufRTC[0] & (STS_A1F | STS_A2F);
+  if (fired == 0)
+    return(0);
+
+  // Alarm flags are only cleared by writing 0, so write 1 for any flag 
+  // not being cleared in case it was set after the read.
+  _bufRTC[0] |= (STS_A1F | STS_A2F);
+  _bufRTC[0] &= ~fired;
+  if (writeDevice(ADDR_STATUS_REGISTER, _bufRTC, 1) != 1)
+  {
+    _almPending = true;   // flags not cleared, try again next time
+    return(0);
+  }
+
+  if (fired & STS_A1F) dispatchAlarm(1);
+  if (fired & STS_A2F) dispatchAlarm(2);
+
+  return(((fired & STS_A1F) ? DS3231_ALARM1 : 0) | ((fired & STS_A2F) ? DS3231_ALARM2 : 0));
+}
+
+boolean MD_DS3231::setAlarm1Type(almType_t almType)
+{
+  // read the current data into the buffer
+  readDevice(ADDR_ALM1, _bufRTC, 4);
+
+  int16_t alm1Type = static_cast<int16_t>(almType);
+  // split each bit of almType to the seventh bit
+  for(uint8_t i = 0; i < 4; i++) {
+    bitWrite(_bufRTC[i], 7, bitRead(alm1Type, i));
+  }
+  // set the D bit
+  bitWrite(_bufRTC[3], 6, bitRead(alm1Type, 4));
+
+  // write the data back out
+  return(writeDevice(ADDR_ALM1, _bufRTC, 4) == 4);
+}
+
+almType_t MD_DS3231::alarmType(const uint8_t *buf, uint8_t alarm)
+// Decode the alarm type from the mask bits in the alarm registers in buf. 
+// For alarm 1 buf starts at the seconds register, for alarm 2 at the minutes register.
+{
+  uint8_t m = 0;
+
+  if (alarm == 1)
+  {
+    // create a value with bits 0=M1, 1=M2, 2=M3, 3=M4, 4=D
+    for(uint8_t i = 0; i < 4; i++) {
+      m |= (buf[i] & 0x80) >> (7 - i);  
+    }
+    m |= (buf[3] & 0x40) >> 2;
+  }
+  else
+  {
+    // create a value with bits 0=M2, 1=M3, 2=M4, 4=D
+    for(uint8_t i = 0; i < 3; i++) {
+      m |= (buf[i] & 0x80) >> (7 - i);  
+    }
+    m |= (buf[2] & 0x40) >> 3;
+    m |= 0x40;  //alarm2 types have the sixth bit set
+  }
+
+  return static_cast<almType_t>(m);  
+}
+
+almType_t MD_DS3231::getAlarm1Type(void)
+{
+  // read the current data into the buffer
+  if (readDevice(ADDR_ALM1, _bufRTC, 4) != 4) return DS3231_ALM_ERROR;
+
+  return(alarmType(_bufRTC, 1));
+}
+
+boolean MD_DS3231::setAlarm2Type(almType_t almType)
+{
+  // read the current data into the buffer
+  readDevice(ADDR_ALM2, _bufRTC, 3);
+
+  int16_t alm2Type = static_cast<int16_t>(almType);
+  // split each bit of almType to the seventh bit
+  for(uint8_t i = 0; i < 3; i++) {
+    bitWrite(_bufRTC[i], 7, bitRead(alm2Type, i));
+  }
+  // set the D bit
+  bitWrite(_bufRTC[2], 6, bitRead(alm2Type, 3));
+
+  // write the data back out
+  return(writeDevice(ADDR_ALM2, _bufRTC, 3) == 3);  
+}
+
+almType_t MD_DS3231::getAlarm2Type(void)
+{
+  // read the current data into the buffer
+  if (readDevice(ADDR_ALM2, _bufRTC, 3) != 3) return DS3231_ALM_ERROR;
+
+  return(alarmType(_bufRTC, 2));
+}
+
+void MD_DS3231::getFields(timeData_t &t)
+// copy the interface registers into a time structure
+{
+  t.yyyy = yyyy;
+  t.mm = mm;
+  t.dd = dd;
+  t.h = h;
+  t.m = m;
+  t.s = s;
+#if ENABLE_DOW
+  t.dow = dow;
+#else
+  t.dow = 0;
+#endif
+#if ENABLE_12H
+  t.pm = pm;
+#else
+  t.pm = 0;
+#endif
+}
+
+void MD_DS3231::setFields(const timeData_t &t)
+// copy a time structure into the interface registers
+{
+  yyyy = t.yyyy;
+  mm = t.mm;
+  dd = t.dd;
+  h = t.h;
+  m = t.m;
+  s = t.s;
+#if ENABLE_DOW
+  dow = t.dow;
+#endif
+#if ENABLE_12H
+  pm = t.pm;
+#endif
+}
+
+void MD_DS3231::unpackAlarm(const uint8_t *buf, uint8_t entryPoint, timeData_t &t)
+// general routine for unpacking alarm registers from device
+// Assumes the buffer is set up as per Alarm 1 registers. For Alarm 2 (missing seconds), 
+// the first byte of the Alarm data should in byte 1
+{
+  if (entryPoint < 2) t.s = BCD2bin(buf[ADDR_SEC]);
+  
+  t.m = BCD2bin(buf[ADDR_MIN]);
+#if ENABLE_12H
+  if (buf[ADDR_CTL_12H] & CTL_12H)     // 12 hour clock
+  {
+    t.h = BCD2bin(buf[ADDR_HR] & 0x1f);
+    t.pm = (buf[ADDR_CTL_PM] & CTL_PM);
+  } 
+  else
+  {
+#endif
+    t.h = BCD2bin(buf[ADDR_HR] & 0x3f);
+#if ENABLE_12H
+    t.pm = 0;
+  }
+#endif
+
+#if ENABLE_DOW
+  if (buf[ADDR_CTL_DYDT] & CTL_DYDT)   // Day or date?
+  {
+    t.dow = BCD2bin(buf[ADDR_DAY] & 0x0f);
+    t.dd = 0;
+  } else {
+#endif
+    t.dd = BCD2bin(buf[ADDR_ADATE] & 0x3f);
+#if ENABLE_DOW
+    t.dow = 0;
+  }
+#endif
+}
+
+void MD_DS3231::unpackTime(const uint8_t *buf, timeData_t &t)
+// unpack the time registers from the device
+{
+  uint8_t v[8];
+#if ENABLE_12H
+  boolean mode12 = (buf[ADDR_CTL_12H] & CTL_12H);   // 12 hour clock
+#else
+  boolean mode12 = false;
+#endif
+
+  decodeBCD(buf, v, mode12 ? timeMask12 : timeMask24);
+
+  t.s = v[ADDR_SEC];
+  t.m = v[ADDR_MIN];
+  t.h = v[ADDR_HR];
+#if ENABLE_12H
+  t.pm = mode12 ? (buf[ADDR_CTL_PM] & CTL_PM) : 0;
+#endif
+#if ENABLE_DOW
+  t.dow = v[ADDR_DAY];
 #endif
-_cbAlarm1(nullptr), _cbAlarm2(nullptr) 
+  t.dd = v[ADDR_TDATE];
+  t.mm = v[ADDR_MON];
+
+  t.yyyy = v[ADDR_YR] + (CENTURY * 100);
+  if (buf[ADDR_CTL_100] & CTL_100)
+    t.yyyy += 100;
+}
+
+boolean MD_DS3231::readAlarm1(void)
+// Read the current time from the RTC and unpack it into the object variables
+// return true if the function succeeded
+{
+  timeData_t t;
+
+  // read the current data into the buffer
+  if (readDevice(ADDR_ALM1, _bufRTC, 4) != 4)
+    return(false);
+
+  getFields(t);
+  unpackAlarm(_bufRTC, 1, t);
+  setFields(t);
+
+  return(true);
+}
+
+boolean MD_DS3231::readAlarm2(void)
+// Read the current time from the RTC and unpack it into the object variables
+// return true if the function succeeded
+{
+  timeData_t t;
+
+  // read the current data into the buffer
+  if (readDevice(ADDR_ALM2, &_bufRTC[1], 3) != 3)
+    return(false);
+
+  getFields(t);
+  unpackAlarm(_bufRTC, 2, t);
+  setFields(t);
+
+  return(true);
+}
+
+boolean MD_DS3231::readTime(void)
+// Read the current time from the RTC and unpack it into the object variables
+// return true if the function succeeded
+{
+  timeData_t t;
+
+  // read the current data into the buffer
+  if (readDevice(ADDR_TIME, _bufRTC, 7) != 7)
+    return(false);
+
+  // unpack it
+  getFields(t);
+  unpackTime(_bufRTC, t);
+  correctTime(t, timeMode12(_bufRTC));
+  setFields(t);
+
+  return(true);
+}
+
+boolean MD_DS3231::readSnapshot(snapshot_t &snap)
+// Read all the device registers in one burst and decode them
+// return true if the function succeeded
+{
+  if (readDevice(ADDR_TIME, snap.reg, DS3231_RAM_MAX) != DS3231_RAM_MAX)
+    return(false);
+
+  decodeSnapshot(snap);
+
+  return(true);
+}
+
+void MD_DS3231::decodeSnapshot(snapshot_t &snap)
+// Decode the raw registers in the snapshot into the snapshot values
+{
+  memset(&snap.time, 0, sizeof(snap.time));
+  unpackTime(&snap.reg[ADDR_TIME], snap.time);
+
+  memset(&snap.alarm1, 0, sizeof(snap.alarm1));
+  unpackAlarm(&snap.reg[ADDR_ALM1], 1, snap.alarm1);
+  snap.alarm1Type = alarmType(&snap.reg[ADDR_ALM1], 1);
+
+  memset(&snap.alarm2, 0, sizeof(snap.alarm2));
+  unpackAlarm(&snap.reg[ADDR_ALM2 - 1], 2, snap.alarm2);
+  snap.alarm2Type = alarmType(&snap.reg[ADDR_ALM2], 2);
+
+  snap.aging = (int8_t)snap.reg[ADDR_AGING_REGISTER];
+  snap.tempQuarters = tempDecode(&snap.reg[ADDR_TEMP_REGISTER]);
+  snap.temperature = snap.tempQuarters * 0.25;
+}
+
+codeStatus_t snapshot_t::status(codeRequest_t item) const
+// Obtain the status of the controllable item from the snapshot registers.
+// Return DS3231_ERROR otherwise.
+{
+  uint8_t addr, mask;
+
+  if (!statusLocation(item, addr, mask))
+    return(DS3231_ERROR);
+
+  return(statusDecode(item, mask, reg[addr]));
+}
+
+void MD_DS3231::packAlarm(uint8_t *buf, uint8_t alarm, const timeData_t &t, almType_t almType, boolean mode12)
+// General routine for packing the alarm time and trigger type into device registers.
+// The buffer is set up as per Alarm 1 registers. For Alarm 2 (missing seconds), 
+// the first byte of the Alarm data is in byte 1 and byte 0 is not used.
+// The hour in t must already be in the format given by mode12.
+{
+  uint8_t type = static_cast<uint8_t>(almType);
+  uint8_t first = (alarm < 2) ? ADDR_SEC : ADDR_MIN;
+  boolean day = (alarm < 2) ? bitRead(type, 4) : bitRead(type, 3);
+
+  memset(buf, 0, 4);
+  buf[ADDR_SEC] = bin2BCD(t.s);
+  buf[ADDR_MIN] = bin2BCD(t.m);
+  buf[ADDR_HR] = bin2BCD(t.h);
+#if ENABLE_12H
+  if (mode12)     // 12 hour clock
+  {
+    buf[ADDR_CTL_12H] |= CTL_12H;
+    if (t.pm) buf[ADDR_CTL_PM] |= CTL_PM;
+  }
+#else
+  (void)mode12;
+#endif
+  if (day)
+    buf[ADDR_DAY] = bin2BCD(t.dow) | CTL_DYDT;
+  else
+    buf[ADDR_ADATE] = bin2BCD(t.dd);
+
+  // split each bit of almType to the seventh bit of each register
+  for (uint8_t i = first; i <= ADDR_ADATE; i++)
+    if (bitRead(type, i - first)) buf[i] |= 0x80;
+}
+
+boolean MD_DS3231::readMode12(boolean &mode12)
+// Find the current time mode, from the shadow cache if possible
+{
+  mode12 = false;
+#if ENABLE_12H
+  uint8_t v;
+
+  if (!readRegister(ADDR_CTL_12H, CTL_12H, v))
+    return(false);
+  mode12 = (v & CTL_12H);
+#endif
+
+  return(true);
+}
+
+void MD_DS3231::alarmFields(timeData_t &t, boolean mode12)
+// Copy the interface registers for an alarm, allowing both 5PM and 17 formats in 12H mode
+{
+  getFields(t);
+  if (mode12 && t.h > 12)
+  {
+    t.h -= 12;
+    t.pm = 1;
+  }
+}
+
+boolean MD_DS3231::writeAlarm1(almType_t almType)
+{
+  timeData_t t;
+  boolean mode12;
+
+  if (!readMode12(mode12))
+    return(false);
+  alarmFields(t, mode12);
+  packAlarm(_bufRTC, 1, t, almType, mode12);
+
+  return(writeDevice(ADDR_ALM1, _bufRTC, 4) == 4);
+}
+
+boolean MD_DS3231::writeAlarm2(almType_t almType)
+{
+  timeData_t t;
+  boolean mode12;
+
+  if (!readMode12(mode12))
+    return(false);
+  alarmFields(t, mode12);
+  packAlarm(_bufRTC, 2, t, almType, mode12);
+
+  return(writeDevice(ADDR_ALM2, &_bufRTC[1], 3) == 3);
+}
+
+boolean MD_DS3231::writeAlarms(const timeData_t &alm1, almType_t almType1, const timeData_t &alm2, almType_t almType2, boolean enable1, boolean enable2)
+// Write both alarms and the alarm interrupt enables as one block from 0x07 to 0x0e
+{
+  timeData_t t1 = alm1, t2 = alm2;
+  uint8_t buf[ADDR_CONTROL_REGISTER - ADDR_ALM1 + 1];
+  uint8_t a2[4];
+  uint8_t ctl;
+  boolean mode12;
+
+  if (!readMode12(mode12) || 
+      !readRegister(ADDR_CONTROL_REGISTER, (uint8_t)~(CTL_A1IE | CTL_A2IE | CTL_CONV), ctl))
+    return(false);
+
+#if ENABLE_12H
+  if (mode12)
+  {
+    to12H(t1);
+    to12H(t2);
+  }
+#endif
+  packAlarm(&buf[0], 1, t1, almType1, mode12);
+  packAlarm(a2, 2, t2, almType2, mode12);
+  memcpy(&buf[ADDR_ALM2 - ADDR_ALM1], &a2[1], 3);
+
+  // a 0 written to CONV has no effect, so don't start a conversion
+  ctl &= ~(CTL_A1IE | CTL_A2IE | CTL_CONV);
+  if (enable1) ctl |= CTL_A1IE;
+  if (enable2) ctl |= CTL_A2IE;
+  buf[ADDR_CONTROL_REGISTER - ADDR_ALM1] = ctl;
+
+  return(writeDevice(ADDR_ALM1, buf, sizeof(buf)) == sizeof(buf));
+}
+
+void MD_DS3231::packTime(uint8_t *buf, boolean mode12)
+// Pack up the time stored in the object variables into 7 bytes of buf,
+// in 12H mode if mode12 is true
+{
+  uint8_t v[8] = { 0 };
+
+  // pack it up in the current space
+  v[ADDR_SEC] = s;
+  v[ADDR_MIN] = m;
+#if ENABLE_12H
+  if (mode12)     // 12 hour clock
+  {
+    if (h > 12) {
+      h -= 12;
+      pm = true;
+    }
+  }
+#endif
+  v[ADDR_HR] = h;
+#if ENABLE_DOW
+  v[ADDR_DAY] = dow;
+#endif
+  v[ADDR_TDATE] = dd;
+  v[ADDR_MON] = mm;
+
+  uint16_t y = yyyy - (CENTURY * 100);
+  boolean c = (y >= 100);
+  if (c) y -= 100;
+  v[ADDR_YR] = y;
+
+  encodeBCD(v, buf);
+
+  // add the control bits
+#if ENABLE_12H
+  if (mode12)
+  {
+    buf[ADDR_CTL_12H] |= CTL_12H;
+    if (pm) buf[ADDR_CTL_PM] |= CTL_PM;
+  }
+#endif
+  if (c) buf[ADDR_CTL_100] |= CTL_100;
+}
+
+boolean MD_DS3231::writeTime(void)
+// Pack up and write the time stored in the object variables to the RTC
+// Note: Setting the time will also start the clock of it is halted
+// return true if the function succeeded
+{
+  boolean mode12;
+
+  if (!readMode12(mode12))
+    return(false);
+  packTime(_bufRTC, mode12);
+  if (writeDevice(ADDR_TIME, _bufRTC, 7) != 7)
+    return(false);
+  if (_corr != nullptr)
+    noteTimeWrite(_bufRTC);
+
+  return(true);
+}
+
+boolean MD_DS3231::startAsync(asyncOp_t op, uint8_t addr, uint8_t wlen, uint8_t *rbuf, uint8_t rlen)
+// Start an asynchronous bus transfer. The register address is in _asyncBuf[0] 
+// and any data to write follows it.
+{
+  boolean b;
+
+  _asyncBuf[0] = addr;
+  _asyncOp = op;
+
+  busStart();
+  b = _bus.startTransaction(_addr, _asyncBuf, wlen, rbuf, rlen, _asyncSts);
+  _bus.unlock();
+
+  if (!b)
+    _asyncOp = ASYNC_NONE;
+
+  return(b);
+}
+
+boolean MD_DS3231::readTimeAsync(void)
+// Start reading the current time from the RTC
+{
+  if (_asyncOp != ASYNC_NONE)
+    return(false);
+
+  return(startAsync(ASYNC_READ_TIME, ADDR_TIME, 1, &_asyncBuf[1], 7));
+}
+
+boolean MD_DS3231::writeTimeAsync(void)
+// Start writing the time stored in the object variables to the RTC
+{
+  boolean mode12;
+
+  if (_asyncOp != ASYNC_NONE || !readMode12(mode12))
+    return(false);
+  packTime(&_asyncBuf[1], mode12);
+
+  return(startAsync(ASYNC_WRITE_TIME, ADDR_TIME, 8, nullptr, 0));
+}
+
+boolean MD_DS3231::readSnapshotAsync(snapshot_t &snap)
+// Start reading all the device registers into the snapshot
+{
+  if (_asyncOp != ASYNC_NONE)
+    return(false);
+
+  _asyncSnap = &snap;
+  return(startAsync(ASYNC_READ_SNAPSHOT, ADDR_TIME, 1, snap.reg, DS3231_RAM_MAX));
+}
+
+asyncStatus_t MD_DS3231::poll(void)
+// Check on the progress of the current asynchronous transfer and 
+// finish it off when the bus transfer has completed.
+{
+  asyncOp_t op = _asyncOp;
+
+  if (op == ASYNC_NONE)
+    return(DS3231_ASYNC_IDLE);
+
+  _bus.lock();
+  asyncStatus_t sts = _bus.pollTransaction(_asyncSts);
+  _bus.unlock();
+
+  if (sts == DS3231_ASYNC_BUSY)
+    return(sts);
+
+  _asyncOp = ASYNC_NONE;   // transfer is finished - allow the library to use the bus again
+
+  if (sts == DS3231_ASYNC_DONE)
+  {
+    switch (op)
+    {
+      case ASYNC_READ_TIME:
+      {
+        timeData_t t;
+
+#if ENABLE_SHADOW_CACHE
+        updateShadow(ADDR_TIME, &_asyncBuf[1], 7);
+#endif
+        if (_corr != nullptr) noteTimeRead(&_asyncBuf[1]);
+        getFields(t);
+        unpackTime(&_asyncBuf[1], t);
+        correctTime(t, timeMode12(&_asyncBuf[1]));
+        setFields(t);
+      }
+      break;
+
+      case ASYNC_WRITE_TIME:
+        _incValid = _msValid = false;
+#if ENABLE_SHADOW_CACHE
+        updateShadow(ADDR_TIME, &_asyncBuf[1], 7);
+#endif
+        if (_corr != nullptr) noteTimeWrite(&_asyncBuf[1]);
+      break;
+
+      case ASYNC_READ_SNAPSHOT:
+#if ENABLE_SHADOW_CACHE
+        updateShadow(ADDR_TIME, _asyncSnap->reg, DS3231_RAM_MAX);
+#endif
+        if (_corr != nullptr) noteTimeRead(_asyncSnap->reg);
+        decodeSnapshot(*_asyncSnap);
+      break;
+
+      default: break;
+    }
+  }
+
+  if (_cbAsync != nullptr) _cbAsync(sts);
+
+  return(sts);
+}
+
+void MD_DS3231::addSeconds(timeData_t &t, uint32_t secs)
+// Advance the time (24H format) by secs seconds, carrying into the date
+{
+  uint32_t x = t.s + secs;
+
+  t.s = x % 60;
+  x /= 60;
+  if (x == 0) return;
+
+  x += t.m;
+  t.m = x % 60;
+  x /= 60;
+  if (x == 0) return;
+
+  x += t.h;
+  t.h = x % 24;
+  x /= 24;            // now the number of days to add
+  if (x == 0) return;
+
+  if (t.dow != 0)
+    t.dow = ((t.dow - 1 + x) % 7) + 1;
+
+  while (x-- != 0)
+  {
+    if (++t.dd > daysInMonth(t.yyyy, t.mm))
+    {
+      t.dd = 1;
+      if (++t.mm > 12)
+      {
+        t.mm = 1;
+        t.yyyy++;
+      }
+    }
+  }
+}
+
+void MD_DS3231::to24H(timeData_t &t)
+// Convert the hour from 12H (1-12 and pm) to 24H format
+{
+  t.h %= 12;
+  if (t.pm) t.h += 12;
+  t.pm = 0;
+}
+
+void MD_DS3231::to12H(timeData_t &t)
+// Convert the hour from 24H to 12H (1-12 and pm) format
+{
+  t.pm = (t.h >= 12);
+  t.h %= 12;
+  if (t.h == 0) t.h = 12;
+}
+
+void MD_DS3231::civilFromDays(int32_t days, timeData_t &t)
+// Gregorian date and day of week for the days since 1970-01-01. 
+// Inverse of daysFromCivil().
+{
+  uint32_t z = days + 719468;
+  uint32_t era = z / 146097;
+  uint32_t doe = z - era * 146097;                                      // [0, 146096]
+  uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365; // [0, 399]
+  uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);               // [0, 365]
+  uint32_t mp = (5 * doy + 2) / 153;                                    // [0, 11]
+
+  t.dd = doy - (153 * mp + 2) / 5 + 1;
+  t.mm = mp < 10 ? mp + 3 : mp - 9;
+  t.yyyy = yoe + era * 400 + (t.mm <= 2);
+  t.dow = ((z + 3) % 7) + 1;    // 0000-03-01 was a Wednesday
+}
+
+void MD_DS3231::secs2Time(uint32_t secs, timeData_t &t)
+// Convert seconds since 2000-01-01 00:00:00 to 24H format time
+{
+  t.s = secs % 60;
+  secs /= 60;
+  t.m = secs % 60;
+  secs /= 60;
+  t.h = secs % 24;
+  t.pm = 0;
+  civilFromDays(secs / 24 + EPOCH_DAYS_2000, t);
+}
+
+void MD_DS3231::time2tm(const timeData_t &t, struct tm &tm)
+// Convert 24H format time to a struct tm
+{
+  int32_t days = daysFromCivil(t.yyyy, t.mm, t.dd);
+
+  memset(&tm, 0, sizeof(tm));
+  tm.tm_sec = t.s;
+  tm.tm_min = t.m;
+  tm.tm_hour = t.h;
+  tm.tm_mday = t.dd;
+  tm.tm_mon = t.mm - 1;
+  tm.tm_year = t.yyyy - 1900;
+  tm.tm_wday = (days + 4) % 7;    // 1970-01-01 was a Thursday
+  tm.tm_yday = days - daysFromCivil(t.yyyy, 1, 1);
+}
+
+void MD_DS3231::tm2Time(const struct tm &tm, timeData_t &t)
+// Convert a struct tm to 24H format time
+{
+  t.s = tm.tm_sec;
+  t.m = tm.tm_min;
+  t.h = tm.tm_hour;
+  t.pm = 0;
+  t.dd = tm.tm_mday;
+  t.mm = tm.tm_mon + 1;
+  t.yyyy = tm.tm_year + 1900;
+  t.dow = ((daysFromCivil(t.yyyy, t.mm, t.dd) + 4) % 7) + 1;
+}
+
+uint8_t MD_DS3231::timeChanges(const timeData_t &t1, const timeData_t &t2)
+// Return the DS3231_CHG_* bits for the fields that differ between the two times
+{
+  uint8_t c = 0;
+
+  if (t1.s != t2.s) c |= DS3231_CHG_SEC;
+  if (t1.m != t2.m) c |= DS3231_CHG_MIN;
+  if (t1.h != t2.h) c |= DS3231_CHG_HOUR;
+  if (t1.dd != t2.dd) c |= DS3231_CHG_DATE;
+  if (t1.mm != t2.mm) c |= DS3231_CHG_MONTH;
+  if (t1.yyyy != t2.yyyy) c |= DS3231_CHG_YEAR;
+  if (t1.dow != t2.dow) c |= DS3231_CHG_DOW;
+  if ((t1.pm != 0) != (t2.pm != 0)) c |= DS3231_CHG_PM;
+
+  return(c);
+}
+
+boolean MD_DS3231::readTimeIncremental(uint8_t &changed)
+// Read the seconds and only read the rest of the time registers if they could 
+// have changed. As long as the previous read was less than a minute ago, the 
+// higher fields can only have changed if the seconds are lower than last time.
+{
+  const uint32_t MAX_GAP = 30000;   // ms, well inside a minute allowing for millis() error
+  uint32_t ms = millis();
+  boolean full = !_incValid || (ms - _incReadMs >= MAX_GAP) ||
+                 (_incRefresh != 0 && ms - _incFullMs >= _incRefresh * 1000UL);
+  timeData_t t = _incTime;
+
+  changed = 0;
+
+  if (!full)
+  {
+    uint8_t v;
+
+    if (readDevice(ADDR_SEC, &v, 1) != 1)
+      return(false);
+    t.s = BCD2bin(v & 0x7f);
+    full = (t.s < _incTime.s);    // wrapped around, another minute
+  }
+
+  if (full)
+  {
+    // all the registers are latched at the start of the transfer, so 
+    // the time read is always consistent even if it ticks over
+    if (readDevice(ADDR_TIME, _bufRTC, 7) != 7)
+      return(false);
+    memset(&t, 0, sizeof(t));
+    unpackTime(_bufRTC, t);
+    _incMode12 = timeMode12(_bufRTC);
+    _incFullMs = ms;
+  }
+
+  _incReadMs = ms;
+  changed = trackTime(t, _incMode12);
+
+  return(true);
+}
+
+boolean MD_DS3231::readTime(uint8_t &changed)
+// Read the current time and work out what changed since the last time
+{
+  timeData_t t;
+
+  changed = 0;
+
+  if (readDevice(ADDR_TIME, _bufRTC, 7) != 7)
+    return(false);
+
+  memset(&t, 0, sizeof(t));
+  unpackTime(_bufRTC, t);
+  _incMode12 = timeMode12(_bufRTC);
+  _incReadMs = _incFullMs = millis();
+  changed = trackTime(t, _incMode12);
+
+  return(true);
+}
+
+uint8_t MD_DS3231::trackTime(const timeData_t &t, boolean mode12)
+// Remember the time just read, load the interface registers and invoke 
+// the time change callbacks. Return the DS3231_CHG_* bits that changed.
+// Changes are found in the corrected time, but the uncorrected time is 
+// kept for the next incremental read.
+{
+  static const uint8_t cbMask[TCB_MAX] PROGMEM =
+  {
+    DS3231_CHG_DATE | DS3231_CHG_MONTH | DS3231_CHG_YEAR | DS3231_CHG_DOW,  // TCB_DAY
+    (uint8_t)~(DS3231_CHG_SEC | DS3231_CHG_MIN),                            // TCB_HOUR
+    (uint8_t)~DS3231_CHG_SEC,                                               // TCB_MINUTE
+    DS3231_CHG_ALL,                                                         // TCB_SECOND
+  };
+  timeData_t c = t;
+
+  correctTime(c, mode12);
+
+  uint8_t changed = _incValid ? timeChanges(_incShown, c) : DS3231_CHG_ALL;
+
+  _incValid = true;
+  _incTime = t;
+  _incShown = c;
+  setFields(c);
+
+  for (uint8_t i = 0; i < TCB_MAX; i++)
+    if (_cbTime[i] != nullptr && (changed & pgm_read_byte(&cbMask[i])))
+      _cbTime[i](_ctxTime[i]);
+
+  return(changed);
+}
+
+boolean MD_DS3231::readTime(timeData_t &t)
+// Read the current time from the RTC in 24H format
+{
+  if (readDevice(ADDR_TIME, _bufRTC, 7) != 7)
+    return(false);
+
+  memset(&t, 0, sizeof(t));
+  unpackTime(_bufRTC, t);
+#if ENABLE_12H
+  if (_bufRTC[ADDR_CTL_12H] & CTL_12H)
+    to24H(t);
+#endif
+  correctTime(t, false);
+
+  return(true);
+}
+
+void MD_DS3231::correctTime(timeData_t &t, boolean mode12)
+// Add the software correction, rounded to whole seconds, to the time just read
+{
+  if (_corr == nullptr)
+    return;
+
+  timeData_t u = t;
+
+  if (mode12) to24H(u);
+  if (u.yyyy > SECS_MAX_YEAR)
+    return;
+
+  uint32_t secs = time2Secs(u);
+  int32_t ms = _corr->offsetMs(secs);
+  int32_t adj = (ms + ((ms < 0) ? -500 : 500)) / 1000;
+
+  if (adj == 0)
+    return;
+
+  int32_t days = (int32_t)((secs + adj) / 86400UL) - (int32_t)(secs / 86400UL);
+
+  secs2Time(secs + adj, u);
+#if ENABLE_DOW
+  // the device day of week numbering is set by the application, so move it on 
+  // by the number of days rather than calculating it from the date
+  if (t.dow != 0) 
+    u.dow = ((t.dow - 1 + (days % 7) + 7) % 7) + 1;
+  else
+    u.dow = 0;
+#else
+  (void)days;
+  u.dow = t.dow;
+#endif
+#if ENABLE_12H
+  if (mode12) to12H(u);
+#else
+  u.pm = t.pm;
+#endif
+
+  t = u;
+}
+
+uint32_t MD_DS3231::bufSecs(const uint8_t *buf)
+// Convert the packed time registers in buf to seconds since 2000-01-01.
+// Return DS3231_SECS_UNKNOWN if the time is after the range of the seconds.
+{
+  timeData_t t;
+
+  memset(&t, 0, sizeof(t));
+  unpackTime(buf, t);
+  if (timeMode12(buf)) to24H(t);
+  if (t.yyyy > SECS_MAX_YEAR)
+    return(DS3231_SECS_UNKNOWN);
+
+  return(time2Secs(t));
+}
+
+void MD_DS3231::noteTimeRead(const uint8_t *buf)
+// Keep the uncorrected time just read from the packed time in buf, to work 
+// out the RTC time before the next write
+{
+  _readSecs = bufSecs(buf);
+  _readMs = millis();
+  _readValid = (_readSecs != DS3231_SECS_UNKNOWN);
+}
+
+void MD_DS3231::noteTimeWrite(const uint8_t *buf)
+// Tell the correction the RTC has been set to the packed time in buf. The 
+// time before the write is the last time read, if it was read recently, 
+// moved on by the nearest number of seconds since it was read.
+{
+  uint32_t ms = millis() - _readMs;
+  uint32_t rtcSecs = DS3231_SECS_UNKNOWN;
+
+  if (_readValid && ms <= DS3231_CORR_READ_MS)
+    rtcSecs = _readSecs + (ms + 500) / 1000;
+  noteTimeRead(buf);
+
+  _corr->timeWritten(rtcSecs, _readSecs);
+}
+
+void MD_DS3231::packTime(const timeData_t &t, uint8_t *buf, boolean mode12)
+// Pack the 24H format time into 7 bytes of buf, in 12H mode if mode12 is true
+{
+  timeData_t save, w = t;
+
+#if ENABLE_12H
+  if (mode12)
+    to12H(w);
+#endif
+
+  getFields(save);
+  setFields(w);
+  packTime(buf, mode12);
+  setFields(save);
+}
+
+boolean MD_DS3231::writeTime(const timeData_t &t)
+// Write the 24H format time to the RTC in the current 12/24H mode
+{
+  boolean mode12;
+
+  if (!readMode12(mode12))
+    return(false);
+  packTime(t, _bufRTC, mode12);
+  if (writeDevice(ADDR_TIME, _bufRTC, 7) != 7)
+    return(false);
+  if (_corr != nullptr)
+    noteTimeWrite(_bufRTC);
+
+  return(true);
+}
+
+boolean MD_DS3231::measureWriteLatency(uint32_t &us)
+// Estimate the time from the start of a time write to the seconds register
+// being written. Time a read of the time registers (10 bytes on the bus 
+// with the addresses) and scale to the first 3 bytes of the write.
+{
+  uint8_t buf[7];
+  uint32_t start = micros();
+
+  if (readDevice(ADDR_TIME, buf, 7) != 7)
+    return(false);
+
+  us = ((micros() - start) * 3) / 10;
+
+  return(true);
+}
+
+boolean MD_DS3231::writeTimeAligned(uint32_t secs, uint16_t ms)
+// Wait for the next reference second boundary, less the write latency, and 
+// write the time for that second. The countdown chain restarts when the 
+// seconds register is written, so the RTC then changes seconds in step 
+// with the reference.
+{
+  uint32_t start = micros();
+  uint32_t lat = _alignLatency;
+  uint32_t wait, raw;
+  uint8_t buf[7];
+  timeData_t t;
+  boolean mode12;
+
+  if (ms > 999) ms = 999;
+  if (lat == 0 && !measureWriteLatency(lat))
+    return(false);
+  _lastLatency = (lat > 0xffff) ? 0xffff : lat;
+  if (!readMode12(mode12))
+    return(false);
+
+  // read the RTC, unless it was just read to measure the latency, so the 
+  // correction can be told the time before the write
+  if (_corr != nullptr && _alignLatency != 0 && !readRawSecs(raw))
+    return(false);
+
+  // the first boundary that leaves time to prepare the write
+  wait = (1000 - ms) * 1000UL;
+  secs++;
+  while (wait < lat + ALIGN_PREPARE_US)
+  {
+    wait += 1000000UL;
+    secs++;
+  }
+
+  do
+  {
+    secs2Time(secs, t);
+    packTime(t, buf, mode12);
+    if (micros() - start <= wait - lat)
+      break;
+    wait += 1000000UL;    // preparing took too long, aim for the next second
+    secs++;
+  } while (true);
+
+  while (micros() - start < wait - lat)
+    ;   // wait for the time to write
+
+  if (writeDevice(ADDR_TIME, buf, 7) != 7)
+    return(false);
+  if (_corr != nullptr)
+    noteTimeWrite(buf);
+
+  return(true);
+}
+
+boolean MD_DS3231::readSecs(uint32_t &secs)
+// Read the current time from the RTC as seconds since 2000-01-01 00:00:00
+{
+  timeData_t t;
+
+  if (!readTime(t) || t.yyyy > SECS_MAX_YEAR)
+    return(false);
+  secs = time2Secs(t);
+
+  return(true);
+}
+
+void MD_DS3231::sqwSnapshot(uint32_t &count, uint32_t &us)
+// Consistent copy of the edge count and time, which may change in an interrupt
 {
-  Wire.begin(sda, scl);
+  do
+  {
+    count = _sqwCount;
+    us = _sqwUs;
+  } while (count != _sqwCount);
 }
-#endif
 
-boolean MD_DS3231::checkAlarm1(void)
-// Check the alarm. If time happened then call the callback function and reset the flag
+boolean MD_DS3231::sqwAnchor(void)
+// Find the square wave edge that started the current RTC second. At 1Hz this 
+// is the last edge. At the kHz rates the seconds are polled until they change,
+// and the change happened between the edges counted before the last two reads.
 {
-  boolean b = (status(DS3231_A1_FLAG) == DS3231_ON);
+  uint8_t buf[7], v;
+  uint32_t count, us, secs, prev = 0, prevCount = 0;
+  uint32_t start = millis();
+  boolean first = true;
 
-  if (b)
+  if (!readRegister(ADDR_CONTROL_REGISTER, CTL_RS | CTL_INTCN, v))
+    return(false);
+  _msRate = sqwRate(v);
+  if (_msRate == 0)
+    return(false);    // no square wave output
+
+  do
   {
-    control(DS3231_A1_FLAG, DS3231_OFF);
-    if (_cbAlarm1 != nullptr) _cbAlarm1();
-  }    
+    sqwSnapshot(count, us);
+    if (count == 0 || micros() - us > SQW_TIMEOUT_US(_msRate))
+      return(false);  // edges are not being counted
+    if (readDevice(ADDR_TIME, buf, 7) != 7)
+      return(false);
+    secs = bufSecs(buf);
+    if (secs == DS3231_SECS_UNKNOWN)
+      return(false);
+
+    if (_msRate == 1)
+    {
+      // retry if an edge arrived during the read, as it is not clear which second was read
+      if (_sqwCount == count)
+        break;
+    }
+    else
+    {
+      if (!first && secs != prev)
+      {
+        count = prevCount + ((count - prevCount) / 2);
+        break;
+      }
+      first = false;
+      prev = secs;
+      prevCount = count;
+    }
 
-  return(b);
+    if (millis() - start > 1100)
+      return(false);
+  } while (true);
+
+  _msEdges = count;
+  _msSecs = secs;
+  _msValid = true;
+
+  return(true);
 }
 
-boolean MD_DS3231::checkAlarm2(void)
-// Check the alarm. If time happened then call the callback function and reset the flag
+boolean MD_DS3231::readTimeMs(uint32_t &secs, uint16_t &ms)
+// Work out the time from the edges counted since the anchor edge and micros() 
+// since the last edge, then check the seconds register agrees.
 {
-  boolean b = (status(DS3231_A2_FLAG) == DS3231_ON);
+  const uint16_t MARGIN = 20;   // ms either side of a second where the register may be a second different
+  uint32_t count, us, since, edges, fracUs;
+  uint8_t v;
 
-  if (b)
+  for (uint8_t retry = 0; retry < 2; retry++)
   {
-    control(DS3231_A2_FLAG, DS3231_OFF);
-    if (_cbAlarm2 != NULL) _cbAlarm2();
+    if (!_msValid && !sqwAnchor())
+      return(false);
+
+    sqwSnapshot(count, us);
+    since = micros() - us;
+    if (since > SQW_TIMEOUT_US(_msRate))
+    {
+      _msValid = false;   // edges have stopped
+      return(false);
+    }
+    if (readDevice(ADDR_SEC, &v, 1) != 1)
+      return(false);
+
+    edges = count - _msEdges;
+    secs = _msSecs + (edges / _msRate);
+    if (_msRate == 1)
+      fracUs = since;
+    else    // 1000000 / rate = 15625 / (rate / 64) without overflow
+      fracUs = (((edges % _msRate) * 15625UL) / (_msRate / 64)) + since;
+    secs += fracUs / 1000000UL;
+    ms = (fracUs % 1000000UL) / 1000;
+
+    // the seconds may tick over between the edge count and the register read
+    v = BCD2bin(v & 0x7f);
+    if (v == secs % 60 ||
+       (ms >= 1000 - MARGIN && v == (secs + 1) % 60) ||
+       (ms < MARGIN && v == (secs + 59) % 60))
+    {
+      if (_corr != nullptr)
+      {
+        int64_t t = ((int64_t)secs * 1000) + ms + _corr->offsetMs(secs);
+
+        secs = t / 1000;
+        ms = t % 1000;
+      }
+      return(true);
+    }
+
+    _msValid = false;   // edges were missed or the time changed, find the anchor again
   }
 
-  return(b);
+  return(false);
 }
 
-boolean MD_DS3231::setAlarm1Type(almType_t almType)
+boolean MD_DS3231::readTimeMs(timeData_t &t, uint16_t &ms)
+// Millisecond time as a 24H format time structure
 {
-  // read the current data into the buffer
-  readDevice(ADDR_ALM1, bufRTC, 4);
+  uint32_t secs;
 
-  int16_t alm1Type = static_cast<int16_t>(almType);
-  // split each bit of almType to the seventh bit
-  for(uint8_t i = 0; i < 4; i++) {
-    bitWrite(bufRTC[i], 7, bitRead(alm1Type, i));
-  }
-  // set the D bit
-  bitWrite(bufRTC[3], 6, bitRead(alm1Type, 4));
+  if (!readTimeMs(secs, ms))
+    return(false);
+  secs2Time(secs, t);
 
-  // write the data back out
-  return(writeDevice(ADDR_ALM1, bufRTC, 4) == 4);
+  return(true);
 }
 
-almType_t MD_DS3231::getAlarm1Type(void)
+boolean MD_DS3231::readRawSecs(uint32_t &secs)
+// Read the current time as seconds without the software correction
 {
-  // read the current data into the buffer
-  if (readDevice(ADDR_ALM1, bufRTC, 4) != 4) return DS3231_ALM_ERROR;
+  uint32_t s;
 
-  // create a value with bits 0=M1, 1=M2, 2=M3, 3=M4, 4=D
-  uint16_t m = 0;
-  for(uint8_t i = 0; i < 4; i++) {
-    m |= (bufRTC[i] & 0x80) >> (7 - i);  
-  }
-  m |= (bufRTC[3] & 0x40) >> 2;
+  if (readDevice(ADDR_TIME, _bufRTC, 7) != 7)
+    return(false);
+  s = bufSecs(_bufRTC);
+  if (s == DS3231_SECS_UNKNOWN)
+    return(false);
+  secs = s;
 
-  return static_cast<almType_t>(m);  
+  return(true);
 }
 
-boolean MD_DS3231::setAlarm2Type(almType_t almType)
+boolean MD_DS3231::readEpoch(uint32_t &epoch)
+// Read the current time from the RTC as Unix time
 {
-  // read the current data into the buffer
-  readDevice(ADDR_ALM2, bufRTC, 3);
+  timeData_t t;
 
-  int16_t alm2Type = static_cast<int16_t>(almType);
-  // split each bit of almType to the seventh bit
-  for(uint8_t i = 0; i < 3; i++) {
-    bitWrite(bufRTC[i], 7, bitRead(alm2Type, i));
-  }
-  // set the D bit
-  bitWrite(bufRTC[2], 6, bitRead(alm2Type, 3));
+  if (!readTime(t) || t.yyyy > EPOCH_MAX_YEAR)
+    return(false);
+  epoch = time2Epoch(t);
 
-  // write the data back out
-  return(writeDevice(ADDR_ALM2, bufRTC, 3) == 3);  
+  return(true);
 }
 
-almType_t MD_DS3231::getAlarm2Type(void)
+boolean MD_DS3231::writeEpoch(uint32_t epoch)
+// Write the Unix time to the RTC
 {
-  // read the current data into the buffer
-  if (readDevice(ADDR_ALM2, bufRTC, 3) != 3) return DS3231_ALM_ERROR;
+  timeData_t t;
 
-  // create a value with bits 0=M2, 1=M3, 2=M4, 4=D
-  uint8_t m = 0;
-  for(uint8_t i = 0; i < 3; i++) {
-    m |= (bufRTC[i] & 0x80) >> (7 - i);  
-  }
-  m |= (bufRTC[2] & 0x40) >> 3;
+  if (epoch < EPOCH_SECS_2000)
+    return(false);
+  secs2Time(epoch - EPOCH_SECS_2000, t);
 
-  return static_cast<almType_t>(m | 0x40); //alarm2 types have the sixth bit set
+  return(writeTime(t));
 }
 
-boolean MD_DS3231::unpackAlarm(uint8_t entryPoint)
-// general routine for unpacking alarm registers from device
-// Assumes the buffer is set up as per Alarm 1 registers. For Alarm 2 (missing seconds), 
-// the first byte of the Alarm data should in byte 1
+#ifndef ARDUINO
+boolean MD_DS3231::readEpoch64(int64_t &epoch)
+// Read the current time from the RTC as 64 bit Unix time
 {
-  if (entryPoint < 2) s = BCD2bin(bufRTC[ADDR_SEC]);
-  
-  m = BCD2bin(bufRTC[ADDR_MIN]);
-#if ENABLE_12H
-  if (bufRTC[ADDR_CTL_12H] & CTL_12H)     // 12 hour clock
-  {
-    h = BCD2bin(bufRTC[ADDR_HR] & 0x1f);
-    pm = (bufRTC[ADDR_CTL_PM] & CTL_PM);
-  } 
-  else
-  {
-#endif
-    h = BCD2bin(bufRTC[ADDR_HR] & 0x3f);
-#if ENABLE_12H
-    pm = 0;
-  }
-#endif
+  timeData_t t;
 
-#if ENABLE_DOW
-  if (bufRTC[ADDR_CTL_DYDT] & CTL_DYDT)   // Day or date?
-  {
-    dow = BCD2bin(bufRTC[ADDR_DAY] & 0x0f);
-    dd = 0;
-  } else {
-#endif
-    dd = BCD2bin(bufRTC[ADDR_ADATE] & 0x3f);
-#if ENABLE_DOW
-    dow = 0;
-  }
-#endif
+  if (!readTime(t))
+    return(false);
+  epoch = (((int64_t)daysFromCivil(t.yyyy, t.mm, t.dd) * 24 + t.h) * 60 + t.m) * 60 + t.s;
 
   return(true);
 }
 
-boolean MD_DS3231::readAlarm1(void)
-// Read the current time from the RTC and unpack it into the object variables
-// return true if the function succeeded
+boolean MD_DS3231::writeEpoch64(int64_t epoch)
+// Write the 64 bit Unix time to the RTC
 {
-  // read the current data into the buffer
-  if (readDevice(ADDR_ALM1, bufRTC, 4) != 4)
-    return(false);
+  timeData_t t;
 
-  unpackAlarm(1);
-
-  return(true);
+  if (epoch < (int64_t)EPOCH_SECS_2000 || epoch >= EPOCH_SECS_2200)
+    return(false);
+  t.s = epoch % 60;
+  epoch /= 60;
+  t.m = epoch % 60;
+  epoch /= 60;
+  t.h = epoch % 24;
+  t.pm = 0;
+  civilFromDays(epoch / 24, t);
+
+  return(writeTime(t));
 }
+#endif
 
-boolean MD_DS3231::readAlarm2(void)
-// Read the current time from the RTC and unpack it into the object variables
-// return true if the function succeeded
+boolean MD_DS3231::readTime(struct tm &tm)
+// Read the current time from the RTC into a struct tm
 {
-  // read the current data into the buffer
-  if (readDevice(ADDR_ALM2, &bufRTC[1], 3) != 3)
+  timeData_t t;
+
+  if (!readTime(t))
     return(false);
-  unpackAlarm(2);
+  time2tm(t, tm);
 
   return(true);
 }
 
-boolean MD_DS3231::readTime(void)
-// Read the current time from the RTC and unpack it into the object variables
-// return true if the function succeeded
+boolean MD_DS3231::writeTime(const struct tm &tm)
+// Write the time in a struct tm to the RTC
 {
-  // read the current data into the buffer
-  if (readDevice(ADDR_TIME, bufRTC, 7) != 7)
-    return(false);
+  timeData_t t;
 
-  // unpack it
-  s = BCD2bin(bufRTC[ADDR_SEC]);
-  m = BCD2bin(bufRTC[ADDR_MIN]);
-#if ENABLE_12H
-  if (bufRTC[ADDR_CTL_12H] & CTL_12H) // 12 hour clock
-  {
-    h = BCD2bin(bufRTC[ADDR_HR] & 0x1f);
-    pm = (bufRTC[ADDR_CTL_PM] & CTL_PM);
-  }
-  else
-  {
-#endif
-    h = BCD2bin(bufRTC[ADDR_HR] & 0x3f);
-#if ENABLE_12H
-    pm = 0;
-  }
-#endif
-#if ENABLE_DOW
-  dow = BCD2bin(bufRTC[ADDR_DAY]);
-#endif
-  dd = BCD2bin(bufRTC[ADDR_TDATE]);
-  mm = BCD2bin(bufRTC[ADDR_MON]);
+  tm2Time(tm, t);
 
-  yyyy = BCD2bin(bufRTC[ADDR_YR]) + (CENTURY * 100);
-  if (bufRTC[ADDR_CTL_100] & CTL_100)
-    yyyy += 100;
-
-  return(true);
+  return(writeTime(t));
 }
 
-boolean MD_DS3231::packAlarm(uint8_t entryPoint)
+boolean MD_DS3231::writeAlarm1Secs(uint32_t secs, almType_t almType)
+// Set alarm 1 to the date and time given as seconds since 2000-01-01 00:00:00
 {
-#if ENABLE_12H
-    // check what time mode is current
-    boolean mode12 = (status(DS3231_12H) == DS3231_ON);
-#endif
+  timeData_t t;
+  boolean mode12;
 
-    CLEAR_BUFFER;
-    
-    if (entryPoint < 2) bufRTC[ADDR_SEC] = bin2BCD(s);
-    
-    bufRTC[ADDR_MIN] = bin2BCD(m);
+  if (!readMode12(mode12))
+    return(false);
+
+  secs2Time(secs, t);
 #if ENABLE_12H
-    if (mode12)     // 12 hour clock
-    {
-      if (h > 12) {
-        h -= 12;
-        pm = true;
-      }
-          
-      bufRTC[ADDR_HR] = bin2BCD(h);
-      if (pm) bufRTC[ADDR_CTL_PM] |= CTL_PM;
-      bufRTC[ADDR_CTL_12H] |= CTL_12H;
-    }
-    else
-#endif        
-      bufRTC[ADDR_HR] = bin2BCD(h);
-#if ENABLE_DOW
-    if (dow != 0) // signal that this is a date, not day
-    {
-      bufRTC[ADDR_DAY] = bin2BCD(dow);
-      bufRTC[ADDR_CTL_DYDT] |= CTL_DYDT; 
-    }
-    else
-    {
-#endif          
-      bufRTC[ADDR_ADATE] = bin2BCD(dd);
-      bufRTC[ADDR_CTL_DYDT] &= ~CTL_DYDT;
-#if ENABLE_DOW
-    }
+  if (mode12)
+    to12H(t);
 #endif
+  packAlarm(_bufRTC, 1, t, almType, mode12);
 
-    return(true);
+  return(writeDevice(ADDR_ALM1, _bufRTC, 4) == 4);
 }
 
-boolean MD_DS3231::writeAlarm1(almType_t almType)
+void MD_DS3231::setFastClock(boolean b, uint16_t resync)
 {
-  packAlarm(1);
-  if (writeDevice(ADDR_ALM1, bufRTC, 4) != 4)
-    return(false);
-  return(setAlarm1Type(almType));
+  _fastEnabled = b;
+  _fastResync = resync;
+  _fastValid = false;
 }
 
-boolean MD_DS3231::writeAlarm2(almType_t almType)
+void MD_DS3231::fastAnchor(void)
+// Set the fast clock from the RTC. Any square wave edge seen while reading 
+// the RTC makes it unclear which second was read, so read it again.
 {
-  packAlarm(2);
-  if (writeDevice(ADDR_ALM2, &bufRTC[1], 3) != 3)
-    return(false);
-  return(setAlarm2Type(almType));
+  uint8_t retry = 3;
+  uint32_t edges;
+
+  do
+  {
+    noInterrupts();
+    edges = _sqwCount;
+    interrupts();
+    _fastValid = readTime();
+  } while (_fastValid && _sqwCount != edges && --retry != 0);
+
+  if (!_fastValid)
+    return;
+
+  _fastAnchorMs = _fastMs = millis();
+  _fastEdges = edges;
+  _fastSqw = false;
+  getFields(_fastTime);
+#if ENABLE_12H
+  _fastMode12 = (_bufRTC[ADDR_CTL_12H] & CTL_12H);
+  if (_fastMode12)    // keep the software clock in 24H format
+    to24H(_fastTime);
+#endif
 }
 
-boolean MD_DS3231::writeTime(void)
-// Pack up and write the time stored in the object variables to the RTC
-// Note: Setting the time will also start the clock of it is halted
-// return true if the function succeeded
+void MD_DS3231::now(void)
+// Load the interface registers with the current time
 {
-#if ENABLE_12H
-  boolean mode12 = (status(DS3231_12H) == DS3231_ON);
-#endif  
-  CLEAR_BUFFER;
-  
-  // pack it up in the current space
-  bufRTC[ADDR_SEC] = bin2BCD(s);
-  bufRTC[ADDR_MIN] = bin2BCD(m);
-#if ENABLE_12H
-  if (mode12)     // 12 hour clock
+  if (!_fastEnabled)
   {
-    if (h > 12) {
-      h -= 12;
-      pm = true;
-    }
-    
-    bufRTC[ADDR_HR] = bin2BCD(h);
-    if (pm) bufRTC[ADDR_CTL_PM] |= CTL_PM;
-    bufRTC[ADDR_CTL_12H] |= CTL_12H;
+    readTime();
+    return;
   }
-  else
-#endif
-    bufRTC[ADDR_HR] = bin2BCD(h);
-    
-#if ENABLE_DOW
-  bufRTC[ADDR_DAY] = bin2BCD(dow);
-#endif
-  bufRTC[ADDR_TDATE] = bin2BCD(dd);
-  bufRTC[ADDR_MON] = bin2BCD(mm);
 
-  uint16_t y = yyyy - (CENTURY * 100);
-  if (y > 100) {
-    bufRTC[ADDR_CTL_100] |= CTL_100;
-    y -= 100;
+  if (!_fastValid || (_fastResync != 0 && millis() - _fastAnchorMs >= _fastResync * 1000UL))
+  {
+    fastAnchor();
+    return;
   }
-  bufRTC[ADDR_YR] = bin2BCD(y);
-  
-  return(writeDevice(ADDR_TIME, bufRTC, 7) == 7);
+
+  // Work out the seconds since the last call from the square wave or from the 
+  // local timer. Both are taken as differences from the last sample so the 
+  // counters can wrap.
+  uint32_t edges, secs = 0;
+
+  noInterrupts();
+  edges = _sqwCount;
+  interrupts();
+
+  if (edges != _fastEdges)
+  {
+    secs = edges - _fastEdges;
+    _fastEdges = edges;
+    _fastSqw = true;
+  }
+  else if (!_fastSqw)
+  {
+    secs = (millis() - _fastMs) / 1000;
+    _fastMs += secs * 1000UL;
+  }
+
+  if (secs != 0)
+    addSeconds(_fastTime, secs);
+
+  timeData_t t = _fastTime;
+#if ENABLE_12H
+  if (_fastMode12)
+    to12H(t);
+#endif
+  setFields(t);
 }
 
 uint8_t MD_DS3231::readRAM(uint8_t addr, uint8_t* buf, uint8_t len)
 // Read len bytes from the RTC, starting at address addr, and put them in buf
 // Reading includes all bytes at addresses RAM_BASE_READ to DS3231_RAM_MAX
 {
-  if ((NULL == buf) || (addr < RAM_BASE_READ) || 
-      (len == 0) ||(addr + len - 1 > DS3231_RAM_MAX))
+  if ((NULL == buf) || (len == 0) || (addr + len - 1 > DS3231_RAM_MAX))
     return(0);
 
   CLEAR_BUFFER;
@@ -452,32 +1794,64 @@ uint8_t MD_DS3231::writeRAM(uint8_t addr, uint8_t* buf, uint8_t len)
 // Write len bytes from buffer buf to the RTC, starting at address addr
 // Writing includes all bytes at addresses RAM_BASE_READ to DS3231_RAM_MAX
 {
-  if ((NULL == buf) || (addr < RAM_BASE_READ) || 
-      (len == 0) || (addr + len - 1 >= DS3231_RAM_MAX))
+  if ((NULL == buf) || (len == 0) || (addr + len - 1 >= DS3231_RAM_MAX))
   return(0);
 
   return(writeDevice(addr, buf, len));	// write all the data at once
 }
 
-uint8_t MD_DS3231::calcDoW(uint16_t yyyy, uint8_t mm, uint8_t dd) 
-// https://en.wikipedia.org/wiki/Determination_of_the_day_of_the_week
-// This algorithm good for dates  yyyy > 1752 and  1 <= mm <= 12
-// Returns dow  01 - 07, 01 = Sunday
+float MD_DS3231::readTempRegister()
 {
-  static const uint8_t ts[] PROGMEM = {0, 3, 2, 5, 0, 3, 5, 1, 4, 6, 2, 4};
-  uint8_t t;
-  memcpy_P(&t, &ts[mm - 1], 1);
+  int16_t t;
+
+  if (!readTemperature(t))
+    return(0.0);
     
-  yyyy -= mm < 3;
-  return ((yyyy + yyyy/4 - yyyy/100 + yyyy/400 + t + dd) % 7) + 1;
+  return(t * 0.25);
 }
 
-float MD_DS3231::readTempRegister()
+boolean MD_DS3231::readTemperature(int16_t &quarters)
+// Read the temperature register in quarter degrees C
 {
-  if (readDevice(ADDR_TEMP_REGISTER, bufRTC, 2) != 2)
-    return(0.0);
-    
-  return(bufRTC[0] + ((bufRTC[1] >> 6) * 0.25));
+  if (readDevice(ADDR_TEMP_REGISTER, _bufRTC, 2) != 2)
+    return(false);
+
+  quarters = tempDecode(_bufRTC);
+
+  return(true);
+}
+
+boolean MD_DS3231::startConversion(void)
+// Start a temperature conversion unless one is already running
+{
+  // control and status registers together
+  if (readDevice(ADDR_CONTROL_REGISTER, _bufRTC, 2) != 2)
+    return(false);
+
+  if ((_bufRTC[0] & CTL_CONV) || (_bufRTC[1] & STS_BSY))
+    return(true);     // a conversion is running, the result will be just as new
+
+  _bufRTC[0] |= CTL_CONV;
+
+  return(writeDevice(ADDR_CONTROL_REGISTER, _bufRTC, 1) == 1);
+}
+
+asyncStatus_t MD_DS3231::pollConversion(int16_t &quarters)
+// Check if the temperature conversion has finished, reading the 
+// control register through to the temperature in one transfer
+{
+  const uint8_t len = ADDR_TEMP_REGISTER - ADDR_CONTROL_REGISTER + 2;
+  uint8_t buf[len];
+
+  if (readDevice(ADDR_CONTROL_REGISTER, buf, len) != len)
+    return(DS3231_ASYNC_ERROR);
+
+  if ((buf[0] & CTL_CONV) || (buf[ADDR_STATUS_REGISTER - ADDR_CONTROL_REGISTER] & STS_BSY))
+    return(DS3231_ASYNC_BUSY);
+
+  quarters = tempDecode(&buf[ADDR_TEMP_REGISTER - ADDR_CONTROL_REGISTER]);
+
+  return(DS3231_ASYNC_DONE);
 }
 
 boolean MD_DS3231::control(codeRequest_t item, uint8_t value)
@@ -622,8 +1996,22 @@ boolean MD_DS3231::control(codeRequest_t item, uint8_t value)
       return(false);  // parameters were wrong - make no fuss and just go back
   }
 
-  // now read the address from the RTC
-  if (readDevice(addr, bufRTC, 1) != 1)
+  // when batching just accumulate the changes to the control and status registers
+  if (_batch && (addr == ADDR_CONTROL_REGISTER || addr == ADDR_STATUS_REGISTER))
+  {
+    uint8_t i = addr - ADDR_CONTROL_REGISTER;
+
+    _batchMask[i] |= mask;
+    _batchCmd[i] = (_batchCmd[i] & ~mask) | cmd;
+    return(true);
+  }
+
+  // now read the address from the RTC, keeping the bits not being changed.
+  // CONV is self clearing so its current value is not needed to write back.
+  uint8_t need = ~mask;
+  if (addr == ADDR_CONTROL_REGISTER) need &= ~CTL_CONV;
+
+  if (!readRegister(addr, need, _bufRTC[0]))
     return(false);
 
 #if ENABLE_12H
@@ -633,23 +2021,23 @@ boolean MD_DS3231::control(codeRequest_t item, uint8_t value)
     switch(value)
     {
       case DS3231_ON: // change to 12H ...
-        if (!(bufRTC[0] & CTL_12H)) // ... and not in 12H mode
+        if (!(_bufRTC[0] & CTL_12H)) // ... and not in 12H mode
         {
-          uint8_t	hour = BCD2bin(bufRTC[0] & 0x3f);
+          uint8_t	hour = BCD2bin(_bufRTC[0] & 0x3f);
           
           if (hour > 12)      // adjust the time, otherwise it looks the same as it does
           {
-            bufRTC[0] = bin2BCD(hour - 12);
-            bufRTC[0] |= CTL_PM;
+            _bufRTC[0] = bin2BCD(hour - 12);
+            _bufRTC[0] |= CTL_PM;
           }
         }
       break;
 
       case DS3231_OFF:  // change to 24H ...
-        if ((bufRTC[0] & CTL_12H) && (bufRTC[0] & CTL_PM))  // ... not in 24H mode and it is PM
+        if ((_bufRTC[0] & CTL_12H) && (_bufRTC[0] & CTL_PM))  // ... not in 24H mode and it is PM
         {
-          uint8_t	hour = BCD2bin(bufRTC[0] & 0x1f);
-          bufRTC[0] = bin2BCD(hour + 12);
+          uint8_t	hour = BCD2bin(_bufRTC[0] & 0x1f);
+          _bufRTC[0] = bin2BCD(hour + 12);
         }
       break;
     }
@@ -657,17 +2045,65 @@ boolean MD_DS3231::control(codeRequest_t item, uint8_t value)
 #endif
 
   // Mask off the new status, set the value and then write it back
-  bufRTC[0] &= ~mask;
-  bufRTC[0] |= cmd;
-  return(writeDevice(addr, bufRTC, 1) == 1);
+  _bufRTC[0] &= ~mask;
+  _bufRTC[0] |= cmd;
+  return(writeDevice(addr, _bufRTC, 1) == 1);
 }
 
-codeStatus_t MD_DS3231::status(codeRequest_t item)
-// Obtain the status of the controllable item and return it.
-// Return DS3231_ERROR otherwise.
+void MD_DS3231::beginControl(void)
+// Start accumulating control() changes
 {
-  uint8_t	mask;       // mask used to clear the bits being set (NOT ANDed to clear the bits in the register)
-  uint8_t addr = ADDR_STATUS_REGISTER;  // address of the byte to read, modify, write. Assume status register, change if not.
+  _batch = true;
+  _batchMask[0] = _batchMask[1] = 0;
+  _batchCmd[0] = _batchCmd[1] = 0;
+}
+
+boolean MD_DS3231::commitControl(void)
+// Write all the accumulated control() changes with one read and one write
+{
+  uint8_t addr, len;
+
+  _batch = false;
+  
+  if (_batchMask[1] == 0)   // control register only
+  {
+    if (_batchMask[0] == 0)  // nothing to do
+      return(true);
+
+    addr = ADDR_CONTROL_REGISTER;
+    len = 1;
+    if (!readRegister(addr, ~(_batchMask[0] | CTL_CONV), _bufRTC[0]))
+      return(false);
+  }
+  else
+  {
+    addr = (_batchMask[0] != 0) ? ADDR_CONTROL_REGISTER : ADDR_STATUS_REGISTER;
+    len = ADDR_STATUS_REGISTER - addr + 1;
+    if (readDevice(addr, _bufRTC, len) != len)
+      return(false);
+
+    // Alarm flags are only cleared by writing 0, so write 1 for any flag
+    // not being changed in case it was set after the read.
+    _bufRTC[len - 1] |= (STS_A1F | STS_A2F) & ~_batchMask[1];
+  }
+
+  // apply the changes to each register and write them back out
+  for (uint8_t i = 0; i < len; i++)
+  {
+    uint8_t j = addr - ADDR_CONTROL_REGISTER + i;
+
+    _bufRTC[i] &= ~_batchMask[j];
+    _bufRTC[i] |= _batchCmd[j];
+  }
+
+  return(writeDevice(addr, _bufRTC, len) == len);
+}
+
+static boolean statusLocation(codeRequest_t item, uint8_t &addr, uint8_t &mask)
+// Work out the register address and bit mask that holds the status of item.
+// Return false if item is not valid.
+{
+  addr = ADDR_STATUS_REGISTER;  // address of the byte to read. Assume status register, change if not.
 
   switch (item)
   {
@@ -685,16 +2121,19 @@ codeStatus_t MD_DS3231::status(codeRequest_t item)
     case DS3231_A1_INT_ENABLE:mask = CTL_A1IE;  addr = ADDR_CONTROL_REGISTER; break;
     case DS3231_A2_INT_ENABLE:mask = CTL_A2IE;  addr = ADDR_CONTROL_REGISTER; break;
     case DS3231_AGING_OFFSET: mask = 0xff;      addr = ADDR_AGING_REGISTER;   break;
-    default:  return(DS3231_ERROR);   // invalid code request
+    default:  return(false);   // invalid code request
   }
 
-  // read the data and return appropriate value
-  readDevice(addr, bufRTC, 1);
-  
+  return(true);
+}
+
+static codeStatus_t statusDecode(codeRequest_t item, uint8_t mask, uint8_t value)
+// Convert the register value into the status for item
+{
   // Handle any multi-bit values
   if (item == DS3231_SQW_TYPE)
   {
-    switch((bufRTC[0] & mask) >> 3)
+    switch((value & mask) >> 3)
     {
         case 0: return(DS3231_SQW_1HZ);
         case 1: return(DS3231_SQW_1KHZ);
@@ -704,9 +2143,26 @@ codeStatus_t MD_DS3231::status(codeRequest_t item)
   } 
   else if (item == DS3231_AGING_OFFSET)
   {
-    return((codeStatus_t)bufRTC[0]);
+    return((codeStatus_t)value);
   }
   
   // any other parameters are single bit ON of OFF
-  return((bufRTC[0] & mask) ? DS3231_ON : DS3231_OFF);
+  return((value & mask) ? DS3231_ON : DS3231_OFF);
+}
+
+codeStatus_t MD_DS3231::status(codeRequest_t item)
+// Obtain the status of the controllable item and return it.
+// Return DS3231_ERROR otherwise.
+{
+  uint8_t mask;       // mask used to isolate the bits for the item
+  uint8_t addr;       // address of the byte to read
+
+  if (!statusLocation(item, addr, mask))
+    return(DS3231_ERROR);
+
+  // read the data and return appropriate value
+  if (!readRegister(addr, mask, _bufRTC[0]))
+    return(DS3231_ERROR);
+
+  return(statusDecode(item, mask, _bufRTC[0]));
 }
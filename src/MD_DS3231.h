@@ -12,7 +12,8 @@ The device
 to the device is interrupted. 
 - maintains seconds, minutes, hours, day, date, month, and year information. 
 - automatically adjusts dates for months with fewer than 31 days, including 
-corrections for leap year. 
+corrections for leap year. The device treats every year divisible by 4 as a leap 
+year, so it is only correct up to 2100 (see isLeapYear()).
 - operates in either the 24-hour or 12-hour format with an AM/PM indicator.
 - includes two programmable time-of day alarms.
 - has and frequency programmable square-wave output.
@@ -38,6 +39,36 @@ ___
 
 Revision History 
 ----------------
+Oct 2026 version 1.5.0
+- Added pluggable bus transport (MD_DS3231_Bus) with Arduino Wire, Linux i2c-dev and in-memory backends
+- Added optional register shadow cache to remove bus reads from status() and control()
+- Added readSnapshot() to read and decode all device registers in one transfer
+- Added beginControl() and commitControl() to batch control() changes
+- Added asynchronous readTimeAsync(), writeTimeAsync() and readSnapshotAsync() completed by poll()
+- Removed global buffer; device address and I2C multiplexer channel configurable per instance
+- Added fast software clock for now(), synchronized to the 1Hz square wave
+- Added serviceAlarms() interrupt driven alarm handling and alarm callbacks with a user context
+- Added MD_DS3231_Scheduler to run any number of timed events from Alarm 1, with time2Secs(), secs2Time(), readSecs() and writeAlarm1Secs()
+- Added readEpoch()/writeEpoch() Unix time, struct tm interoperability and days-from-civil date conversion
+- Made date, day of week and BCD functions constexpr and added parseBuildTime() for __DATE__/__TIME__
+- Added ENABLE_SWAR_BCD word at a time conversion of the time registers
+- Added MD_DS3231_BusStats traffic counting transport and host benchmark in extras/benchmark
+- Added MD_DS3231_BusSim behavioral device simulator transport
+- Added accelerated time and advanceToAlarm() to the simulator for long soak tests
+- Alarm time and trigger type are written in one transfer; added writeAlarms() to set both alarms and their enables together
+- Added readTimeIncremental() to read only the seconds register when the other fields cannot have changed
+- Added readTime() changed field bitmask and onSecond(), onMinute(), onHour() and onDay() callbacks
+- Added readTemperature() in quarter degrees C, startConversion() and pollConversion()
+- Fixed negative temperatures returned by readTempRegister() and in the snapshot
+- Added MD_DS3231_TempLog temperature history with running minimum, maximum, mean and variance
+- Added MD_DS3231_AgingCal aging offset calibration against a reference clock, and crystal drift to the simulator
+- Added setCorrection() software time correction and MD_DS3231_Drift temperature dependent drift model
+- Added writeTimeAligned() to set the time on a reference second boundary, allowing for bus latency
+- Added readTimeMs() millisecond time from the square wave edges counted by sqwEdge() at 1Hz or the kHz rates
+- Added MD_DS3231_Slew to correct the time gradually through the aging offset and/or in software
+- Fixed writing years ending in 00 with the century bit set (eg, 2100)
+- Fixed setCentury() having no effect as ENABLE_DYNAMIC_CENTURY was not checked
+
 Jan 2025 version 1.4.1
 - Improved consistency of error checking when calling readDevice()
 
@@ -147,7 +178,21 @@ __Reading__ the current time from the clock is a call to the readTime() method.
 and time is then available in the interface registers.
 
 __Writing__ the current time is a sequence of writing to the interface registers followed by a call 
-to the writeTime() method.
+to the writeTime() method. The RTC restarts the current second when the time is written, so 
+writeTime() can leave the RTC up to a second away from the source of the time. writeTimeAligned() 
+takes a reference time with milliseconds and waits for the reference second boundary to write the 
+time, allowing for the bus latency, so the RTC seconds change within a few milliseconds of the reference.
+
+__Tracking changes__ to the time is done with readTime() or readTimeIncremental() called with a 
+changed field parameter. This returns DS3231_CHG_* bits for the fields that differ from the previous 
+call, so a display only needs to redraw the parts that changed. Callbacks set with onSecond(), 
+onMinute(), onHour() and onDay() are invoked from these methods when the time has moved on by 
+at least that unit. readTimeIncremental() is cheap enough to call many times each second.
+
+__Milliseconds__ are not counted by the RTC. readTimeMs() counts the square wave edges passed to 
+sqwEdge() from the interrupt handler, from the edge that started a known second, and adds the 
+micros() time since the last edge. At 1Hz the milliseconds come from micros(), at the kHz rates 
+they are counted from the RTC oscillator. Each reading is checked against the seconds register.
 
 ___
 
@@ -181,13 +226,89 @@ a HIGH to LOW transition (FALLING) should be specified as the interrupt trigger.
  + during the interrupt there can be no I2C communications as this uses interrupts. So checking a RTC
  status in the Interrupt Service Routine (ISR) is not possible.
 
+- _Combined Alarms_ are serviced by calling serviceAlarms(), which checks both alarm flags with one read, clears 
+them with one write and invokes the callbacks. Callbacks set with a context pointer receive that pointer, so the 
+handlers need no global variables. With setAlarmInterruptMode() enabled, the INT/SQW interrupt handler only calls 
+alarmInterrupt() and serviceAlarms() does not access the device until an interrupt has occurred.
+
+- _Scheduled Alarms_ are managed by an MD_DS3231_Scheduler object (MD_DS3231_Scheduler.h). The scheduler holds 
+any number of one-shot and recurring events, limited only by the storage supplied by the application, and always 
+programs the earliest one into Alarm 1. Calling MD_DS3231_Scheduler::service() from loop() runs the events that 
+are due and re-arms the alarm for the next one. Event times are seconds since 2000-01-01 (time2Secs()).
+
 The DS3231_LCD_Time example has examples of the different ways of interacting with the RTC.
+
+___
+
+Temperature
+-----------
+The DS3231 measures its temperature every 64 seconds for the TCXO. readTemperature() returns the 
+last value in quarter degrees C using integer arithmetic only. A new conversion can be started with 
+startConversion() and its completion checked with pollConversion(), without waiting.
+
+An MD_DS3231_TempLog object (MD_DS3231_TempLog.h) keeps a history of samples, taken every 
+one or more conversion periods, in a ring buffer supplied by the application. The minimum, maximum, 
+mean and variance of the history are updated with each sample and the history can be exported 
+as packed records.
+
+___
+
+Calibration
+-----------
+The aging offset register (DS3231_AGING_OFFSET) trims the oscillator by about 0.1ppm per step. An 
+MD_DS3231_AgingCal object (MD_DS3231_AgingCal.h) compares the RTC with a reference clock derived 
+from MD_DS3231_RefClock over a window of hours or days, fits the frequency error by least squares and 
+adjusts the aging offset. Each window refines the result of the previous one.
+
+The residual drift after trimming changes with temperature. An MD_DS3231_Drift object 
+(MD_DS3231_Drift.h) learns the drift rate and its temperature coefficient from the differences 
+seen each time the application reads and then sets the time with writeTime(), and corrects the 
+times read between syncs in software through setCorrection(), without writing the device. The 
+model can be saved with getModel() and restored with setModel() at boot.
+
+Setting the time with writeTime() makes the clock jump. An MD_DS3231_Slew object (MD_DS3231_Slew.h) 
+spreads a correction over a period instead, by biasing the aging offset so the RTC itself runs fast 
+or slow, by growing a software correction of the times read, or both. The time read never goes 
+backwards and, as the RTC time is not stepped, each alarm still matches once.
+
+___
+
+Bus Transports
+--------------
+All communications with the device pass through a transport object derived from MD_DS3231_Bus.
+The default constructor uses the Arduino Wire library. Other transports are passed by reference 
+to the MD_DS3231(MD_DS3231_Bus &bus) constructor:
+- MD_DS3231_BusWire uses any Arduino TwoWire object (eg, Wire1 on boards with a second bus).
+- MD_DS3231_BusLinux uses a Linux i2c-dev device (eg, /dev/i2c-1). Register reads are a single 
+combined I2C_RDWR transfer.
+- MD_DS3231_BusMemory is an in-memory register file that allows the library to run on a host 
+without hardware.
+- MD_DS3231_BusSim adds simulated device behavior to the register file: the clock ticks, alarms 
+match and set their flags, the INT/SQW pin is modelled, temperature conversions set BSY and the 
+crystal frequency error and aging offset change the clock rate. Library 
+code and application logic can be tested on a host exactly as they run on the hardware.
+- MD_DS3231_BusStats wraps another transport and counts the transactions and bytes passed to it.
+The host benchmark in extras/benchmark uses it to report the bus cost of each library method 
+and to check it against a saved baseline.
+
+Several MD_DS3231 objects can share one transport, each with its own device address or I2C 
+multiplexer channel (setMuxCallback()). Each transfer locks the transport (MD_DS3231_Bus::lock()), 
+so on Linux different objects can be used from different threads. Each object keeps its own 
+buffers and asynchronous transfer status, so asynchronous transfers on a shared transport 
+report their results to the object that started them. A single object should only be used 
+by one thread at a time. The host tests in extras/test check this and other library 
+behavior against the in-memory and simulated transports. Run them with "make check" in that
+folder.
+
+When built outside the Arduino environment (ARDUINO not defined) the library provides the few 
+Arduino definitions it needs and no default RTC instance is created.
  */
   
 #ifndef MD_DS3231_h
 #define MD_DS3231_h
 
-#include <Arduino.h>
+#include <time.h>
+#include "MD_DS3231_Bus.h"
 /**
  * \file
  * \brief Main header file for the MD_DS3231 library
@@ -253,7 +374,44 @@ The DS3231_LCD_Time example has examples of the different ways of interacting wi
  * \sa setCentury() method.
  *
  */
+#ifdef ARDUINO
 #define ENABLE_RTC_INSTANCE 1 ///< Enable default RTC instance creation
+#else
+#define ENABLE_RTC_INSTANCE 0 ///< No default bus, so no default instance, on a host build
+#endif
+
+/**
+ * \def ENABLE_SHADOW_CACHE
+ * Set to 1 (default) to include the register shadow cache. The cache is 
+ * switched on at run time using setShadowCache(). Disabling this saves 
+ * around 24 bytes of RAM and the related code.
+ *
+ * You can change the default by editing this file directly or using a command
+ * line tool like sed :
+ * sed "s/^#define ENABLE_SHADOW_CACHE 1/#define ENABLE_SHADOW_CACHE 0/" -i MD_DS3231.h
+ *
+ * \sa setShadowCache() method.
+ */
+#define ENABLE_SHADOW_CACHE 1 ///< Enable register shadow cache support
+
+/**
+ * \def ENABLE_SWAR_BCD
+ * Set to 1 to convert the 7 byte time block between BCD and binary a machine
+ * word at a time (SIMD within a register) instead of one field at a time. 
+ * 64 bit words are used on 64 bit targets and 32 bit words otherwise. This is 
+ * the default on everything except 8 bit AVR processors, where the wide 
+ * arithmetic is slower than the byte code.
+ *
+ * You can change the default by defining ENABLE_SWAR_BCD before the library
+ * is included or editing this file directly.
+ */
+#ifndef ENABLE_SWAR_BCD
+#ifdef __AVR__
+#define ENABLE_SWAR_BCD 0 ///< Byte at a time BCD conversion on 8 bit processors
+#else
+#define ENABLE_SWAR_BCD 1 ///< Word at a time BCD conversion
+#endif
+#endif
 
 /**
   * Control and Status Request enumerated type.
@@ -320,9 +478,6 @@ enum codeStatus_t
  DS3231_SQW_8KHZ, ///< Set or get 8kHz square wave specifier for SQW_TYPE parameter
 }; 
 
-// Device parameters
-#define DS3231_RAM_MAX  19  ///< Total number of RAM registers that can be read from the device
-
 /**
   * Alarm Type specifier enumerated type.
   *
@@ -345,6 +500,114 @@ enum almType_t
  DS3231_ALM_DDHMS   = 0b00010000,     ///< Alarm when day, hours, minutes and seconds match (alm 1 only)
 };
 
+// Alarm identifiers returned by serviceAlarms()
+#define DS3231_ALARM1 0x01  ///< Alarm 1 bit in the serviceAlarms() return value
+#define DS3231_ALARM2 0x02  ///< Alarm 2 bit in the serviceAlarms() return value
+
+// Changed field bits returned by readTime() and readTimeIncremental()
+#define DS3231_CHG_SEC   0x01  ///< Seconds (s) changed
+#define DS3231_CHG_MIN   0x02  ///< Minutes (m) changed
+#define DS3231_CHG_HOUR  0x04  ///< Hour (h) changed
+#define DS3231_CHG_DATE  0x08  ///< Date (dd) changed
+#define DS3231_CHG_MONTH 0x10  ///< Month (mm) changed
+#define DS3231_CHG_YEAR  0x20  ///< Year (yyyy) changed
+#define DS3231_CHG_DOW   0x40  ///< Day of week (dow) changed
+#define DS3231_CHG_PM    0x80  ///< AM/PM indicator (pm) changed
+#define DS3231_CHG_ALL   0xff  ///< All fields, returned when there is no previous time to compare
+
+// Software time correction
+#define DS3231_SECS_UNKNOWN 0xffffffffUL ///< Time not known, passed to MD_DS3231_Correction::timeWritten()
+#define DS3231_CORR_READ_MS 10000        ///< Oldest RTC read in ms used for the time before a write, see MD_DS3231_Correction::timeWritten()
+
+#define DS3231_BUILD_TIME MD_DS3231::parseBuildTime(__DATE__, __TIME__) ///< Compile time timeData_t for the build date and time
+
+/**
+ * Time data structure.
+ *
+ * Holds one set of date and time values, in the same format as the 
+ * interface registers of the MD_DS3231 class.
+ */
+struct timeData_t
+{
+  uint16_t yyyy;///< Year including the millennium and century
+  uint8_t mm;   ///< Month (1-12)
+  uint8_t dd;   ///< Date of the month (1-31)
+  uint8_t h;    ///< Hour of the day (1-12) or (0-23) depending on the am/pm or 24h mode setting
+  uint8_t m;    ///< Minutes past the hour (0-59)
+  uint8_t s;    ///< Seconds past the minute (0-59)
+  uint8_t dow;  ///< Day of the week (1-7), zero is an undefined value
+  uint8_t pm;   ///< Non-zero if 12 hour clock mode and PM
+};
+
+/**
+ * Device snapshot structure.
+ *
+ * Filled by the readSnapshot() method with a copy of all the device 
+ * registers read in a single transfer and the decoded values.
+ */
+struct snapshot_t
+{
+  uint8_t reg[DS3231_RAM_MAX]; ///< Raw device registers 0x00 to 0x12
+  timeData_t time;      ///< Current time
+  timeData_t alarm1;    ///< Alarm 1 trigger time (dd, h, m, s, dow, pm)
+  almType_t alarm1Type; ///< Alarm 1 trigger type
+  timeData_t alarm2;    ///< Alarm 2 trigger time (dd, h, m, dow, pm)
+  almType_t alarm2Type; ///< Alarm 2 trigger type
+  int8_t aging;         ///< Aging offset register value
+  float temperature;    ///< Temperature register in degrees C
+  int16_t tempQuarters; ///< Temperature register in quarter degrees C
+
+ /**
+  * Obtain the setting for the specified parameter from the snapshot.
+  *
+  * Works the same way as the MD_DS3231::status() method but uses the register
+  * values in the snapshot rather than reading the device.
+  *
+  * \param item  one of the codeRequest_t values.
+  * \return codeStatus_t value setting or DS3231_ERROR if an error occurred.
+  */
+  codeStatus_t status(codeRequest_t item) const;
+};
+
+/**
+ * Time correction base class.
+ *
+ * Derive from this class to correct the times read from the RTC in software, 
+ * without writing the device. Set the correction with MD_DS3231::setCorrection().
+ */
+class MD_DS3231_Correction
+{
+  public:
+  virtual ~MD_DS3231_Correction(void) {};
+
+  /**
+   * Get the correction for a time read from the RTC
+   *
+   * Called each time the RTC time is read by the library. The returned value is
+   * rounded to the nearest second and added to the time before it is returned.
+   *
+   * \param rtcSecs the time read from the RTC in seconds since 2000-01-01.
+   * \return The correction in milliseconds.
+   */
+  virtual int32_t offsetMs(uint32_t rtcSecs) = 0;
+
+  /**
+   * Note that the RTC time has been set
+   *
+   * Called by the library after a new time has been written to the RTC. The RTC
+   * time before the write is not read again. It is worked out from the last time 
+   * the library read from the RTC, so it is only known if the time was read within
+   * DS3231_CORR_READ_MS before the write, as when the application checks the RTC 
+   * against an accurate source before setting it.
+   *
+   * \param rtcSecs the uncorrected RTC time in seconds since 2000-01-01 before the write, 
+   * DS3231_SECS_UNKNOWN if not known.
+   * \param newSecs the new time in seconds since 2000-01-01, DS3231_SECS_UNKNOWN if it
+   * is after 2135.
+   */
+  virtual void timeWritten(uint32_t rtcSecs, uint32_t newSecs) = 0;
+};
+
 /**
  * Core object for the MD_DS3231 library
  */
@@ -355,12 +618,30 @@ class MD_DS3231
  /** 
   * Class Constructor
   *
-  * Instantiate a new instance of the class. One instance of the class is 
-  * created in the libraries as the RTC object.
-  * 
+  * Instantiate a new instance of the class. One instance of the class is
+  * created in the libraries as the RTC object. This instance uses the
+  * Arduino Wire library as the bus transport.
+  *
   */
   MD_DS3231();
 
+ /**
+  * Class Constructor with a bus transport
+  *
+  * Instantiate a new instance of the class that communicates with the
+  * device through the specified transport. The transport begin() method
+  * is invoked by the constructor.
+  *
+  * Several instances may share the same transport, each with a different 
+  * device address or multiplexer channel (see setMuxCallback()).
+  *
+  * \sa MD_DS3231_Bus class
+  *
+  * \param bus  the transport object to use for all device communications.
+  * \param addr the I2C address of the device (default DS3231_ID).
+  */
+  MD_DS3231(MD_DS3231_Bus &bus, uint8_t addr = DS3231_ID);
+
   /**
   * Overloaded Class Constructor (ESP8266 only)
   *
@@ -408,6 +689,91 @@ class MD_DS3231
   */
   codeStatus_t status(codeRequest_t item);
 
+ /**
+  * Start a batch of control() changes.
+  *
+  * After this method is invoked, control() calls for items in the control and status 
+  * registers are accumulated rather than written to the device. The accumulated changes 
+  * are written by commitControl() using one read and one write, so all the bits change 
+  * at the same time. DS3231_12H and DS3231_AGING_OFFSET are not batched and still take
+  * effect immediately.
+  *
+  * \sa commitControl() method
+  */
+  void beginControl(void);
+
+ /**
+  * Write a batch of control() changes.
+  *
+  * Write all the changes accumulated since beginControl() was invoked and end the batch.
+  * If both the control and status registers are changed they are read and written together.
+  *
+  * \sa beginControl() method
+  *
+  * \return false if errors, true otherwise.
+  */
+  boolean commitControl(void);
+
+/**
+  * Set the callback function for an I2C multiplexer
+  *
+  * When the device is connected through an I2C multiplexer, the callback is 
+  * invoked before every bus transfer to select the multiplexer channel for 
+  * this device. The callback function prototype is
+  *
+  * void functionName(void *ctx, uint8_t channel);
+  *
+  * and is invoked with the context and channel specified here, while the 
+  * transport is locked. Set to NULL (default) to disable this feature.
+  *
+  * \param cb       the address of the callback function.
+  * \param ctx      user context pointer passed to the callback function.
+  * \param channel  the multiplexer channel for this device.
+  * \return false if errors, true otherwise.
+  */
+  inline boolean setMuxCallback(void (*cb)(void *ctx, uint8_t channel), void *ctx, uint8_t channel) 
+    { _cbMux = cb; _muxCtx = ctx; _muxChannel = channel; return(true); };
+
+#if ENABLE_SHADOW_CACHE
+ /**
+  * Enable or disable the register shadow cache.
+  *
+  * When enabled, the library keeps a copy of the device registers as they are 
+  * read or written. Register bits that only change when written by the library 
+  * (configuration bits) are then served from the copy after they are first loaded,
+  * removing the I2C transaction from status() and control() calls. Volatile data 
+  * (time, status flags, temperature and the TCONV bit) is always read from the device.
+  *
+  * Register            | Bits served from the cache
+  * --------------------|-----------------------------------------------
+  * Time (0x00-0x06)    | 12H mode bit only
+  * Alarms (0x07-0x0d)  | All
+  * Control (0x0e)      | All except CONV
+  * Status (0x0f)       | EN32KHZ only
+  * Aging (0x10)        | All
+  * Temperature (0x11-12)| None
+  *
+  * The cache is invalidated whenever it is enabled or disabled. It should not be
+  * used if other bus masters also change the device configuration.
+  *
+  * \sa invalidateShadowCache() method.
+  *
+  * \param b  true to enable the cache, false to disable it.
+  */
+  inline void setShadowCache(boolean b) { _shadowEnabled = b; invalidateShadowCache(); };
+
+ /**
+  * Invalidate the register shadow cache.
+  *
+  * Forces all the cached registers to be read from the device on next use. This 
+  * should be called if the device may have been changed or reset outside the 
+  * control of the library.
+  *
+  * \sa setShadowCache() method.
+  */
+  inline void invalidateShadowCache(void) { _shadowValid = 0; };
+#endif
+
   /** @} */
 
  //--------------------------------------------------------------
@@ -439,6 +805,248 @@ class MD_DS3231
   */
   boolean writeTime(void);
 
+ /**
+  * Read the current time into a time structure
+  *
+  * Query the RTC for the current time and load it into the time structure in 
+  * 24 hour format. The interface registers are not changed.
+  *
+  * \param t  the time structure to fill.
+  * \return false if errors, true otherwise.
+  */
+  boolean readTime(timeData_t &t);
+
+ /**
+  * Write the current time from a time structure
+  *
+  * Write the 24 hour format time in the structure as the current time in the RTC, 
+  * in the current 12/24 hour mode. The pm field is ignored. The interface registers 
+  * are not changed.
+  *
+  * \sa parseBuildTime() method.
+  *
+  * \param t  the time to write.
+  * \return false if errors, true otherwise.
+  */
+  boolean writeTime(const timeData_t &t);
+
+ /**
+  * Write the time so the RTC seconds change with a reference clock
+  *
+  * writeTime() writes the time straight away and the RTC restarts its second
+  * from that moment, so the RTC can be up to a second behind the reference. This 
+  * method takes the reference time now, including the milliseconds, and waits for
+  * the next reference second boundary to write the time for that second. The 
+  * write is started early by the bus latency to the seconds register, which is 
+  * measured by timing a read of the time registers unless set with setWriteLatency().
+  *
+  * The method blocks for up to one second (two if the boundary is too close to 
+  * prepare the write). Call it straight after reading the reference and with 
+  * interrupts enabled so micros() is maintained. Any software correction set with
+  * setCorrection() is told of the write once it has succeeded, with the RTC read 
+  * at the start of the method as the time before the write.
+  *
+  * \sa writeTime() method, setWriteLatency() method
+  *
+  * \param secs  the reference time in seconds since 2000-01-01.
+  * \param ms    the milliseconds into the reference second (0-999).
+  * \return false if errors, true otherwise.
+  */
+  boolean writeTimeAligned(uint32_t secs, uint16_t ms);
+
+ /**
+  * Write the time so the RTC seconds change with a reference clock
+  *
+  * As for writeTimeAligned(uint32_t secs, uint16_t ms) with the reference time 
+  * as a 24 hour format time structure.
+  *
+  * \param t   the reference time.
+  * \param ms  the milliseconds into the reference second (0-999).
+  * \return false if errors, true otherwise.
+  */
+  inline boolean writeTimeAligned(const timeData_t &t, uint16_t ms) { return(writeTimeAligned(time2Secs(t), ms)); };
+
+ /**
+  * Set the bus latency for aligned time writes
+  *
+  * Set the time from the start of a time write to the seconds register being
+  * written, if it is known for the bus in use. 
+  *
+  * \sa writeTimeAligned() method, writeLatency() method
+  *
+  * \param us  the latency in microseconds, 0 (default) to measure it on each write.
+  */
+  inline void setWriteLatency(uint16_t us) { _alignLatency = us; };
+
+ /**
+  * Get the bus latency used by the last aligned time write
+  *
+  * \sa writeTimeAligned() method, setWriteLatency() method
+  *
+  * \return the latency in microseconds.
+  */
+  inline uint16_t writeLatency(void) { return(_lastLatency); };
+
+ /**
+  * Read the current time into a struct tm
+  *
+  * Query the RTC for the current time and convert it to a struct tm in 24 hour 
+  * format. The interface registers are not changed.
+  *
+  * \sa time2tm() method.
+  *
+  * \param tm  the struct tm to fill.
+  * \return false if errors, true otherwise.
+  */
+  boolean readTime(struct tm &tm);
+
+ /**
+  * Write the current time from a struct tm
+  *
+  * Write the time in the struct tm as the current time in the RTC, in the 
+  * current 12/24 hour mode. The day of week is calculated from the date. 
+  * The interface registers are not changed.
+  *
+  * \sa tm2Time() method.
+  *
+  * \param tm  the time to write.
+  * \return false if errors, true otherwise.
+  */
+  boolean writeTime(const struct tm &tm);
+
+ /**
+  * Read the current time and report the fields that changed
+  *
+  * Query the RTC for the current time and load it into the interface registers as 
+  * for readTime(). The fields that changed since the previous call to this method or to 
+  * readTimeIncremental() are returned as a combination of the DS3231_CHG_* bits, or 
+  * DS3231_CHG_ALL for the first call. The onSecond(), onMinute(), onHour() and onDay() 
+  * callbacks are invoked as required.
+  *
+  * \sa readTimeIncremental() method, onSecond() method
+  *
+  * \param changed  set to the DS3231_CHG_* bits for the fields that changed.
+  * \return false if errors, true otherwise.
+  */
+  boolean readTime(uint8_t &changed);
+
+ /**
+  * Read the current time, fetching only the registers that may have changed
+  *
+  * Intended for applications that poll the time many times each second. The 
+  * seconds register is read and, unless it has wrapped around since the last 
+  * call, the other fields are taken from the previous read. A full read of all 
+  * the time registers is done on the first call, when the seconds have wrapped,
+  * when the time was written by the library, when more than 30 seconds have 
+  * passed since the last call (so a whole minute cannot be missed) and when the
+  * refresh interval set by setIncrementalRefresh() has elapsed.
+  *
+  * The time is loaded into the interface registers as for readTime(). The fields 
+  * that changed since the previous call are returned as a combination of the 
+  * DS3231_CHG_* bits, or DS3231_CHG_ALL for the first call. The onSecond(), 
+  * onMinute(), onHour() and onDay() callbacks are invoked as required.
+  *
+  * Changes made to the time registers by another bus master are only detected at 
+  * the next full read.
+  *
+  * \sa readTime() method, setIncrementalRefresh() method
+  *
+  * \param changed  set to the DS3231_CHG_* bits for the fields that changed.
+  * \return false if errors, true otherwise.
+  */
+  boolean readTimeIncremental(uint8_t &changed);
+
+ /**
+  * Set the refresh interval for incremental time reads
+  *
+  * Set the maximum time between full reads of the time registers by 
+  * readTimeIncremental(). The default of 0 only reads all the registers when 
+  * the seconds wrap around, once a minute.
+  *
+  * \sa readTimeIncremental() method
+  *
+  * \param secs  the refresh interval in seconds, 0 to disable.
+  */
+  inline void setIncrementalRefresh(uint8_t secs) { _incRefresh = secs; };
+
+ /**
+  * Set the software time correction
+  *
+  * The correction is applied to every time read from the RTC by the readTime(), 
+  * readTimeIncremental(), readTimeAsync(), readSecs() and readEpoch() family of 
+  * methods, and is told about each time written by the writeTime() family of methods.
+  * The RTC registers are not changed. Snapshots and writeRAM() are not affected.
+  * Times after 2135, beyond the range of the seconds passed to the correction, are
+  * not corrected.
+  *
+  * \sa MD_DS3231_Correction class, readRawSecs() method
+  *
+  * \param corr  the correction object, nullptr to remove the correction.
+  */
+  inline void setCorrection(MD_DS3231_Correction *corr) { _corr = corr; _incValid = false; };
+
+ /**
+  * Set the callback function for each new second
+  *
+  * The callback function prototype is
+  * 
+  * void functionName(void *ctx);
+  *
+  * and is invoked with the context pointer by readTime() and readTimeIncremental() 
+  * with a changed field parameter when any field of the time has changed. The callbacks 
+  * are invoked after the interface registers are loaded, in the order onDay(), onHour(), 
+  * onMinute() and onSecond(). Set to NULL (default) to disable this feature.
+  *
+  * \sa readTime() method, onMinute() method, onHour() method, onDay() method
+  * 
+  * \param cb  the address of the callback function.
+  * \param ctx the user context pointer passed to the callback.
+  * \return false if errors, true otherwise.
+  */
+  inline boolean onSecond(void (*cb)(void *), void *ctx = nullptr) { return(setTimeCallback(TCB_SECOND, cb, ctx)); };
+
+ /**
+  * Set the callback function for each new minute
+  *
+  * Works the same way as onSecond(), but the callback is only invoked when the 
+  * minutes or a larger field of the time have changed.
+  *
+  * \sa onSecond() method.
+  * 
+  * \param cb  the address of the callback function.
+  * \param ctx the user context pointer passed to the callback.
+  * \return false if errors, true otherwise.
+  */
+  inline boolean onMinute(void (*cb)(void *), void *ctx = nullptr) { return(setTimeCallback(TCB_MINUTE, cb, ctx)); };
+
+ /**
+  * Set the callback function for each new hour
+  *
+  * Works the same way as onSecond(), but the callback is only invoked when the 
+  * hour or a larger field of the time have changed.
+  *
+  * \sa onSecond() method.
+  * 
+  * \param cb  the address of the callback function.
+  * \param ctx the user context pointer passed to the callback.
+  * \return false if errors, true otherwise.
+  */
+  inline boolean onHour(void (*cb)(void *), void *ctx = nullptr) { return(setTimeCallback(TCB_HOUR, cb, ctx)); };
+
+ /**
+  * Set the callback function for each new day
+  *
+  * Works the same way as onSecond(), but the callback is only invoked when the 
+  * date, day of week, month or year have changed.
+  *
+  * \sa onSecond() method.
+  * 
+  * \param cb  the address of the callback function.
+  * \param ctx the user context pointer passed to the callback.
+  * \return false if errors, true otherwise.
+  */
+  inline boolean onDay(void (*cb)(void *), void *ctx = nullptr) { return(setTimeCallback(TCB_DAY, cb, ctx)); };
+
  /**
   * Set the current century for year handling in the library
   *
@@ -473,11 +1081,89 @@ class MD_DS3231
  /**
   * Compatibility function - Read the current time
   *
-  * Wrapper to read the current time.
+  * Wrapper to read the current time. If the fast clock is enabled the 
+  * interface registers are loaded from the software clock instead.
+  *
+  * \sa readTime() method, setFastClock() method
+  */
+  void now(void);
+
+ /**
+  * Enable or disable the fast software clock
+  *
+  * When enabled, now() reads the RTC once to set up a software clock and then
+  * loads the interface registers from that clock, without any bus transactions.
+  * The software clock advances using either
+  * - the 1Hz square wave. The application sets DS3231_SQW_TYPE to DS3231_SQW_1HZ, 
+  * DS3231_INT_ENABLE to DS3231_OFF and calls sqwEdge() from the interrupt handler 
+  * for the falling edge of the INT/SQW pin. Each edge advances the clock by exactly 
+  * one second.
+  * - the local millis() timer if no edges are being received. In this case the 
+  * software clock can be up to one second away from the RTC.
+  *
+  * The software clock is set again from the RTC every _resync_ seconds, or only 
+  * when first used if _resync_ is 0.
+  *
+  * \sa now() method, sqwEdge() method
+  *
+  * \param b      true to enable the fast clock, false to disable it.
+  * \param resync the number of seconds between reads of the RTC, 0 for no resync.
+  */
+  void setFastClock(boolean b, uint16_t resync = 0);
+
+ /**
+  * Square wave edge handler for the fast clock and millisecond time
+  *
+  * This method is designed to be called from the interrupt handler for the falling 
+  * edge of the square wave output. It only counts the edge and records micros() 
+  * so it is safe to use in an Interrupt Service Routine.
+  *
+  * \sa setFastClock() method, readTimeMs() method
+  */
+  inline void sqwEdge(void) { _sqwCount++; _sqwUs = micros(); };
+
+ /**
+  * Read the current time to the millisecond
+  *
+  * The RTC only counts whole seconds. This method counts the square wave edges 
+  * passed to sqwEdge() from the edge that started a known RTC second, and adds the
+  * micros() time since the last edge, to give the time to the nearest millisecond.
+  * The square wave comes from the same oscillator as the time, so the result does
+  * not drift from the RTC.
+  *
+  * The application clears DS3231_INT_ENABLE, sets DS3231_SQW_TYPE and calls sqwEdge()
+  * from the interrupt handler for the falling edge of the INT/SQW pin.
+  * - At 1Hz each edge starts a second and the time within the second comes from 
+  * micros(), so the accuracy depends on the local timer and interrupt latency.
+  * - At the 1, 4 and 8kHz rates the edges also count the milliseconds. Finding the 
+  * edge that starts a second needs the seconds to be polled until they change, so 
+  * the first call (and any call after the time is written) can take up to a second.
+  * Edge interrupts must not be lost for long at these rates.
+  *
+  * Each call reads the seconds register to check that it agrees with the counted 
+  * time, allowing for the register changing during the read. If it does not agree 
+  * the starting edge is found again. Any software correction set with setCorrection()
+  * is applied to the millisecond.
+  *
+  * \sa sqwEdge() method, readSecs() method
+  *
+  * \param secs  the variable to receive the time in seconds since 2000-01-01.
+  * \param ms    the variable to receive the milliseconds into the second (0-999).
+  * \return false if errors or square wave edges are not being counted, true otherwise.
+  */
+  boolean readTimeMs(uint32_t &secs, uint16_t &ms);
+
+ /**
+  * Read the current time to the millisecond
+  *
+  * As for readTimeMs(uint32_t &secs, uint16_t &ms) with the time returned as a 24 
+  * hour format time structure. The interface registers are not changed.
   *
-  * \sa readTime() method
+  * \param t   the time structure to fill.
+  * \param ms  the variable to receive the milliseconds into the second (0-999).
+  * \return false if errors or square wave edges are not being counted, true otherwise.
   */
-  void now(void) { readTime(); }
+  boolean readTimeMs(timeData_t &t, uint16_t &ms);
 
  /**
   * Compatibility function - Check if RTC is running
@@ -490,6 +1176,105 @@ class MD_DS3231
   */
   boolean isRunning(void) { return(status(DS3231_CLOCK_HALT) != DS3231_ON); }
 
+ /**
+  * Read all the device registers in one transfer
+  *
+  * Read registers 0x00 to 0x12 in a single I2C burst and decode the current 
+  * time, both alarms, the control and status registers, aging offset and 
+  * temperature into the snapshot structure. This is more efficient than using
+  * the individual methods when several of these values are needed. The 
+  * interface registers are not changed.
+  *
+  * \sa snapshot_t structure
+  *
+  * \param snap  the snapshot structure to fill.
+  * \return false if errors, true otherwise.
+  */
+  boolean readSnapshot(snapshot_t &snap);
+
+ /** @} */
+
+ //--------------------------------------------------------------
+ /** \name Methods for asynchronous operations
+  * @{
+  */
+ /**
+  * Start reading the current time
+  *
+  * Start an asynchronous read of the current time and return without waiting 
+  * for the bus transfer to complete. The interface registers are updated by 
+  * poll() when the transfer has finished.
+  *
+  * Only one asynchronous operation can be in progress at any time. While it is 
+  * in progress all the other methods that access the device will fail.
+  *
+  * \sa poll() method
+  *
+  * \return false if the transfer could not be started, true otherwise.
+  */
+  boolean readTimeAsync(void);
+
+ /**
+  * Start writing the current time
+  *
+  * Start an asynchronous write of the time in the interface registers and return 
+  * without waiting for the bus transfer to complete. The 12H mode is read from the 
+  * device (or the shadow cache) before the transfer is started.
+  *
+  * \sa poll() method, writeTime() method
+  *
+  * \return false if the transfer could not be started, true otherwise.
+  */
+  boolean writeTimeAsync(void);
+
+ /**
+  * Start reading all the device registers
+  *
+  * Start an asynchronous read of all the device registers into the snapshot 
+  * and return without waiting for the bus transfer to complete. The snapshot 
+  * must remain in scope until poll() reports the end of the transfer, when the 
+  * snapshot values are decoded.
+  *
+  * \sa poll() method, readSnapshot() method
+  *
+  * \param snap  the snapshot structure to fill.
+  * \return false if the transfer could not be started, true otherwise.
+  */
+  boolean readSnapshotAsync(snapshot_t &snap);
+
+ /**
+  * Progress the current asynchronous operation
+  *
+  * This method should be called frequently (eg, every time through loop()) 
+  * while an asynchronous operation is in progress. When the bus transfer has 
+  * finished the operation is completed and the callback function, if defined,
+  * is invoked.
+  *
+  * \sa setAsyncCallback() method
+  *
+  * \return DS3231_ASYNC_BUSY while in progress, DS3231_ASYNC_DONE or DS3231_ASYNC_ERROR
+  * once when the operation finishes and DS3231_ASYNC_IDLE if no operation is in progress.
+  */
+  asyncStatus_t poll(void);
+
+ /**
+  * Set the callback function for asynchronous operations
+  *
+  * Pass the address of the callback function to the libraries. The callback function 
+  * prototype is 
+  * 
+  * void functionName(asyncStatus_t status);
+  *
+  * and is invoked from poll() when an asynchronous operation finishes. Set to NULL 
+  * (default) to disable this feature.
+  *
+  * \sa poll() method.
+  * 
+  * \param cb  the address of the callback function.
+  * \return false if errors, true otherwise.
+  */
+  inline boolean setAsyncCallback(void (*cb)(asyncStatus_t)) { _cbAsync = cb; return(true); };
+
  /** @} */
 
  //--------------------------------------------------------------
@@ -523,6 +1308,23 @@ class MD_DS3231
   */
   boolean writeAlarm1(almType_t almType);
 
+ /**
+  * Write the Alarm 1 time from seconds
+  *
+  * Write the date and time specified as the number of seconds since 2000-01-01 00:00:00
+  * as the Alarm 1 trigger time and set the alarm trigger type. The date or day of week is
+  * used as required by the alarm type and the current 12/24H mode of the RTC is used. 
+  * The interface registers are not changed. The alarm matches the RTC registers, so the
+  * time is in the uncorrected time returned by readRawSecs().
+  *
+  * \sa writeAlarm1() method, time2Secs() method, readRawSecs() method
+  *
+  * \param secs    the alarm time in seconds since 2000-01-01 00:00:00.
+  * \param almType the type of alarm trigger required
+  * \return false if errors, true otherwise.
+  */
+  boolean writeAlarm1Secs(uint32_t secs, almType_t almType = DS3231_ALM_DTHMS);
+
  /**
   * Set the Alarm 1 trigger type
   *
@@ -578,6 +1380,26 @@ class MD_DS3231
   */
   inline boolean setAlarm1Callback(void (*cb)(void)) { _cbAlarm1 = cb; return(true); };
 
+ /**
+  * Set the callback function with context for Alarm 1
+  *
+  * Pass the address of the callback function and a user context pointer to the 
+  * libraries. The callback function prototype is
+  * 
+  * void functionName(void *ctx);
+  *
+  * and is invoked with the context pointer when the checkAlarm1() or serviceAlarms()
+  * method detects the alarm. This allows the handler to find its data without using 
+  * global variables. Set to NULL (default) to disable this feature.
+  *
+  * \sa setAlarm1Callback() method.
+  * 
+  * \param cb  the address of the callback function.
+  * \param ctx the user context pointer passed to the callback.
+  * \return false if errors, true otherwise.
+  */
+  inline boolean setAlarm1Callback(void (*cb)(void *), void *ctx) { _cbAlarm1Ctx = cb; _ctxAlarm1 = ctx; return(true); };
+
  /** @} */
 
  //--------------------------------------------------------------
@@ -611,6 +1433,29 @@ class MD_DS3231
   */
   boolean writeAlarm2(almType_t almType); // write the alarm2 values and set almType
 
+ /**
+  * Write both alarms and their interrupt enables
+  *
+  * Write the Alarm 1 and Alarm 2 trigger times and types, and the A1IE and A2IE 
+  * interrupt enable bits in the control register, as one transfer to the RTC. The alarm 
+  * times are in 24 hour format and are converted if the RTC is in 12 hour mode. The
+  * date (dd) or day of week (dow) is used as required by each alarm type. The other
+  * control register bits are not changed. 
+  *
+  * If the shadow cache is enabled this is a single write to the RTC.
+  *
+  * \sa writeAlarm1() method, writeAlarm2() method, setShadowCache() method
+  *
+  * \param alm1     the Alarm 1 time (the seconds field is used).
+  * \param almType1 the type of Alarm 1 trigger required.
+  * \param alm2     the Alarm 2 time (the seconds field is ignored).
+  * \param almType2 the type of Alarm 2 trigger required.
+  * \param enable1  true to enable the Alarm 1 interrupt.
+  * \param enable2  true to enable the Alarm 2 interrupt.
+  * \return false if errors, true otherwise.
+  */
+  boolean writeAlarms(const timeData_t &alm1, almType_t almType1, const timeData_t &alm2, almType_t almType2, boolean enable1, boolean enable2);
+
  /**
   * Set the Alarm 2 trigger type
   *
@@ -666,6 +1511,66 @@ class MD_DS3231
   */
   inline boolean setAlarm2Callback(void (*cb)(void)) { _cbAlarm2 = cb; return(true); };
 
+ /**
+  * Set the callback function with context for Alarm 2
+  *
+  * Works the same way as the setAlarm1Callback() with context, but for Alarm 2.
+  *
+  * \sa setAlarm1Callback() method.
+  * 
+  * \param cb  the address of the callback function.
+  * \param ctx the user context pointer passed to the callback.
+  * \return false if errors, true otherwise.
+  */
+  inline boolean setAlarm2Callback(void (*cb)(void *), void *ctx) { _cbAlarm2Ctx = cb; _ctxAlarm2 = ctx; return(true); };
+
+ /** @} */
+
+ //--------------------------------------------------------------
+ /** \name Methods for combined alarm operations
+  * @{
+  */
+ /**
+  * Check and service both alarms
+  *
+  * Read the status register once, clear all the alarm flags that are set in one 
+  * write and then invoke the callbacks for the alarms that triggered. This is 
+  * cheaper than calling both checkAlarm1() and checkAlarm2().
+  *
+  * In alarm interrupt mode the method returns immediately, without accessing the 
+  * device, unless alarmInterrupt() has been called since the last service.
+  *
+  * \sa setAlarmInterruptMode() method, alarmInterrupt() method
+  *
+  * \return bit mask of DS3231_ALARM1 and DS3231_ALARM2 for the alarms that triggered.
+  */
+  uint8_t serviceAlarms(void);
+
+ /**
+  * Set the alarm interrupt mode
+  *
+  * In alarm interrupt mode serviceAlarms() only reads the device after the INT/SQW 
+  * interrupt handler has called alarmInterrupt(). The application must set up the 
+  * interrupt hardware and enable the device interrupts (DS3231_INT_ENABLE and 
+  * DS3231_A1_INT_ENABLE and/or DS3231_A2_INT_ENABLE).
+  *
+  * \sa serviceAlarms() method, alarmInterrupt() method
+  *
+  * \param b  true to enable interrupt mode, false for polled mode (default).
+  */
+  inline void setAlarmInterruptMode(boolean b) { _almIntMode = b; _almPending = b; };
+
+ /**
+  * Alarm interrupt handler
+  *
+  * This method is designed to be called from the interrupt handler for the INT/SQW
+  * pin. It only marks that an alarm is pending, so it is safe to use in an Interrupt 
+  * Service Routine. The alarm is processed by the next call to serviceAlarms().
+  *
+  * \sa serviceAlarms() method
+  */
+  inline void alarmInterrupt(void) { _almPending = true; };
+
  /** @} */
 
  //--------------------------------------------------------------
@@ -676,8 +1581,7 @@ class MD_DS3231
   * Read the raw RTC clock data
   *
   * Read _len_ bytes from the RTC clock starting at _addr_ as raw data into the 
-  * buffer supplied. The size of the buffer should be at least MAX_BUF bytes long 
-  * (defined in the library cpp file).
+  * buffer supplied. The size of the buffer should be at least _len_ bytes long.
   *
   * \sa writeRAM() method
   *
@@ -703,19 +1607,269 @@ class MD_DS3231
   */
   uint8_t writeRAM(uint8_t addr, uint8_t* buf, uint8_t len);
 
+ /**
+  * Convert BCD to binary
+  *
+  * Usable in constant expressions.
+  *
+  * \param v  the BCD value [0x00..0x99].
+  * \return the binary value.
+  */
+  static constexpr uint8_t BCD2bin(uint8_t v) { return(v - 6 * (v >> 4)); }
+
+ /**
+  * Convert binary to BCD
+  *
+  * Usable in constant expressions.
+  *
+  * \param v  the binary value [0..99].
+  * \return the BCD value.
+  */
+  static constexpr uint8_t bin2BCD(uint8_t v) { return(v + 6 * (v / 10)); }
+
+ /**
+  * Check for a leap year
+  *
+  * Usable in constant expressions. The library uses the Gregorian rule for its date 
+  * calculations (time2Secs(), secs2Time(), calcDoW() and the epoch methods), while the 
+  * device, and MD_DS3231_BusSim, treat every year divisible by 4 as a leap year. The two 
+  * first differ in 2100: the device counts from 28 February 2100 to 29 February, which 
+  * the library calculations take as 1 March, so from then on the device date is one day 
+  * behind. An application running past February 2100 should set the date again when 
+  * the device reaches 29 February 2100.
+  *
+  * \param yyyy  the year.
+  * \return true if the year is a Gregorian leap year.
+  */
+  static constexpr boolean isLeapYear(uint16_t yyyy) { return((yyyy % 4 == 0 && yyyy % 100 != 0) || yyyy % 400 == 0); }
+
+ /**
+  * Calculate the number of days in a month
+  *
+  * Usable in constant expressions. The months after February alternate 31 and 30 
+  * days, with the sequence restarting at August.
+  *
+  * \param yyyy  the year, used for February in leap years.
+  * \param mm    the month [1..12].
+  * \return the number of days in the month.
+  */
+  static constexpr uint8_t daysInMonth(uint16_t yyyy, uint8_t mm)
+  { return(mm == 2 ? (isLeapYear(yyyy) ? 29 : 28) : 30 + ((mm + (mm >> 3)) & 1)); }
+
  /**
   * Calculate day of week for a given date
   *
-  * Given the specified date, calculate the day of week.
+  * Given the specified date, calculate the day of week. Usable in constant expressions.
   * 
-  * \sa Wikipedia https://en.wikipedia.org/wiki/Determination_of_the_day_of_the_week
+  * \sa daysFromCivil() method
   *
   * \param yyyy  year for specified date. yyyy must be > 1752.
   * \param mm  month for the specified date where mm is in the range [1..12], 1 = January.
   * \param dd    date for the specified date in the range [1..31], where 1 = first day of the month.
   * \return dow value calculated [1..7], where 1 = Sunday.
   */
-  uint8_t calcDoW(uint16_t yyyy, uint8_t mm, uint8_t dd);
+  static constexpr uint8_t calcDoW(uint16_t yyyy, uint8_t mm, uint8_t dd)
+  { return(((daysFromCivil(yyyy, mm, dd) + 719468UL + 3) % 7) + 1); }   // 0000-03-01 was a Wednesday
+
+ /**
+  * Convert a date and time to seconds
+  *
+  * Convert the date and time to the number of seconds since 2000-01-01 00:00:00. 
+  * The hour must be in 24 hour format (0-23) and the pm field is ignored. Dates 
+  * from 2000 to 2135 can be represented. Usable in constant expressions.
+  *
+  * \sa secs2Time() method, readSecs() method
+  *
+  * \param t  the date and time to convert.
+  * \return the number of seconds since 2000-01-01 00:00:00.
+  */
+  static constexpr uint32_t time2Secs(const timeData_t &t)
+  { return(((((uint32_t)(daysFromCivil(t.yyyy, t.mm, t.dd) - 10957) * 24) + t.h) * 60 + t.m) * 60 + t.s); }
+
+ /**
+  * Convert a date and time to Unix time
+  *
+  * Convert the date and time to the number of seconds since 1970-01-01 00:00:00. 
+  * The hour must be in 24 hour format (0-23) and the pm field is ignored. Usable 
+  * in constant expressions.
+  *
+  * \sa time2Secs() method, readEpoch() method
+  *
+  * \param t  the date and time to convert.
+  * \return the Unix time.
+  */
+  static constexpr uint32_t time2Epoch(const timeData_t &t)
+  { return((((uint32_t)daysFromCivil(t.yyyy, t.mm, t.dd) * 24 + t.h) * 60 + t.m) * 60 + t.s); }
+
+ /**
+  * Convert seconds to a date and time
+  *
+  * Convert the number of seconds since 2000-01-01 00:00:00 to a date and 
+  * time, including the day of week (1 = Sunday). The hour is in 24 hour format.
+  *
+  * \sa time2Secs() method
+  *
+  * \param secs  the number of seconds since 2000-01-01 00:00:00.
+  * \param t     the date and time structure to fill.
+  */
+  static void secs2Time(uint32_t secs, timeData_t &t);
+
+ /**
+  * Read the current time as seconds
+  *
+  * Read the current time from the RTC and convert it to the number of 
+  * seconds since 2000-01-01 00:00:00. The interface registers are not changed.
+  * Dates after 2135 cannot be represented in 32 bits and return an error.
+  *
+  * \sa time2Secs() method
+  *
+  * \param secs  the variable to receive the number of seconds.
+  * \return false if errors, true otherwise.
+  */
+  boolean readSecs(uint32_t &secs);
+
+ /**
+  * Read the uncorrected time as seconds
+  *
+  * As for readSecs() but without the software correction set by setCorrection().
+  *
+  * \sa readSecs() method, setCorrection() method
+  *
+  * \param secs  the variable to receive the number of seconds.
+  * \return false if errors, true otherwise.
+  */
+  boolean readRawSecs(uint32_t &secs);
+
+ /**
+  * Convert a date to days since the Unix epoch
+  *
+  * Return the number of days from 1970-01-01 to the specified Gregorian date, 
+  * using a branch free days-from-civil algorithm. Usable in constant expressions.
+  *
+  * \sa civilFromDays() method, http://howardhinnant.github.io/date_algorithms.html
+  *
+  * \param yyyy  the year, 1 or later.
+  * \param mm    the month [1..12].
+  * \param dd    the date [1..31].
+  * \return the number of days since 1970-01-01, negative for earlier dates.
+  */
+  static constexpr int32_t daysFromCivil(uint16_t yyyy, uint8_t mm, uint8_t dd)
+  {
+    // The year is counted from March so the leap day is last and the month 
+    // lengths follow a 153 day, 5 month cycle.
+    return((int32_t)(daysBefore((uint32_t)yyyy - (mm <= 2)) + (153 * (mm > 2 ? mm - 3 : mm + 9) + 2) / 5 + dd - 1) - 719468);
+  }
+
+ /**
+  * Parse the compiler build date and time
+  *
+  * Convert the __DATE__ ("Mmm dd yyyy") and __TIME__ ("hh:mm:ss") strings to a 
+  * 24 hour format time structure, including the day of week. This is evaluated 
+  * at compile time when used to initialize a constexpr variable, so no parsing 
+  * code is included in the program. The DS3231_BUILD_TIME macro supplies the 
+  * standard arguments.
+  *
+  * \code
+  * constexpr timeData_t built = DS3231_BUILD_TIME;
+  * RTC.writeTime(built);
+  * \endcode
+  *
+  * \sa writeTime(const timeData_t &t) method
+  *
+  * \param date  the date string in __DATE__ format.
+  * \param time  the time string in __TIME__ format.
+  * \return the date and time.
+  */
+  static constexpr timeData_t parseBuildTime(const char *date, const char *time)
+  { return(buildTime(1000 * (date[7] - '0') + 100 * (date[8] - '0') + 10 * (date[9] - '0') + (date[10] - '0'), parseMonth(date), parse2(&date[4]), time)); }
+
+ /**
+  * Convert days since the Unix epoch to a date
+  *
+  * Set the yyyy, mm, dd and dow fields of the time structure from the number of 
+  * days since 1970-01-01. This is the inverse of daysFromCivil().
+  *
+  * \sa daysFromCivil() method
+  *
+  * \param days  the number of days since 1970-01-01.
+  * \param t     the time structure to update.
+  */
+  static void civilFromDays(int32_t days, timeData_t &t);
+
+ /**
+  * Convert a date and time to a struct tm
+  *
+  * All the fields of the struct tm, including tm_wday and tm_yday, are set. 
+  * tm_isdst is set to 0. The hour must be in 24 hour format.
+  *
+  * \param t   the date and time to convert.
+  * \param tm  the struct tm to fill.
+  */
+  static void time2tm(const timeData_t &t, struct tm &tm);
+
+ /**
+  * Convert a struct tm to a date and time
+  *
+  * The day of week is calculated from the date and tm_wday and tm_yday are ignored. 
+  * The hour is in 24 hour format.
+  *
+  * \param tm  the struct tm to convert.
+  * \param t   the date and time structure to fill.
+  */
+  static void tm2Time(const struct tm &tm, timeData_t &t);
+
+ /**
+  * Read the current time as Unix time
+  *
+  * Read the current time from the RTC as the number of seconds since 1970-01-01 00:00:00, 
+  * with the RTC assumed to be set to UTC. The interface registers are not changed. 
+  * Dates after 2105 cannot be represented in 32 bits and return an error.
+  *
+  * \sa writeEpoch() method
+  *
+  * \param epoch  the variable to receive the Unix time.
+  * \return false if errors, true otherwise.
+  */
+  boolean readEpoch(uint32_t &epoch);
+
+ /**
+  * Write the current time as Unix time
+  *
+  * Set the RTC from the number of seconds since 1970-01-01 00:00:00, including the 
+  * day of week, in the current 12/24 hour mode. The interface registers are not 
+  * changed. Times before 2000 return an error.
+  *
+  * \sa readEpoch() method
+  *
+  * \param epoch  the Unix time.
+  * \return false if errors, true otherwise.
+  */
+  boolean writeEpoch(uint32_t epoch);
+
+#ifndef ARDUINO
+ /**
+  * Read the current time as 64 bit Unix time
+  *
+  * As for readEpoch() but covers the full range of the RTC. Only available 
+  * on a host (ARDUINO not defined).
+  *
+  * \param epoch  the variable to receive the Unix time.
+  * \return false if errors, true otherwise.
+  */
+  boolean readEpoch64(int64_t &epoch);
+
+ /**
+  * Write the current time as 64 bit Unix time
+  *
+  * As for writeEpoch() but covers the full range of the RTC. Only available 
+  * on a host (ARDUINO not defined).
+  *
+  * \param epoch  the Unix time.
+  * \return false if errors or the time is outside 2000-01-01 00:00:00 to 
+  * 2199-12-31 23:59:59, true otherwise.
+  */
+  boolean writeEpoch64(int64_t epoch);
+#endif
 
  /**
   * Read the temperature register in the RTC
@@ -726,6 +1880,52 @@ class MD_DS3231
   * \return the temperature in degrees C.
   */
   float readTempRegister(void);
+
+ /**
+  * Read the temperature register as a fixed point value
+  *
+  * Read the temperature compensation register in the RTC in quarter degrees C,
+  * so 25.75 degrees C is returned as 103 and -7.25 degrees C as -29. This avoids 
+  * floating point code.
+  *
+  * The DS3231 converts the temperature every 64 seconds. Use startConversion() 
+  * and pollConversion() to get an up to date value.
+  *
+  * \sa readTempRegister() method, startConversion() method
+  *
+  * \param quarters  the variable to receive the temperature in 0.25 degrees C.
+  * \return false if errors, true otherwise.
+  */
+  boolean readTemperature(int16_t &quarters);
+
+ /**
+  * Start a temperature conversion
+  *
+  * Set the CONV bit (DS3231_TCONV) to force a temperature conversion and run the TCXO 
+  * algorithm. If a user or automatic conversion is already running (DS3231_TCONV or 
+  * DS3231_BUSY_FLAG on) nothing is written, as the result will be just as recent. 
+  * The method does not wait for the conversion, which takes up to 200ms. Use 
+  * pollConversion() to check when it has finished.
+  *
+  * \sa pollConversion() method
+  *
+  * \return false if errors, true otherwise.
+  */
+  boolean startConversion(void);
+
+ /**
+  * Check if a temperature conversion has finished
+  *
+  * Check the DS3231_TCONV and DS3231_BUSY_FLAG status without waiting. When the 
+  * conversion has finished the new temperature is returned in quarter degrees C. 
+  * The status and temperature are read in one transfer.
+  *
+  * \sa startConversion() method, readTemperature() method
+  *
+  * \param quarters  the variable to receive the temperature in 0.25 degrees C when done.
+  * \return DS3231_ASYNC_BUSY while converting, DS3231_ASYNC_DONE when finished or DS3231_ASYNC_ERROR.
+  */
+  asyncStatus_t pollConversion(int16_t &quarters);
  /** @} */
 
  //--------------------------------------------------------------
@@ -748,17 +1948,133 @@ class MD_DS3231
   /** @} */
 
 private:
+  MD_DS3231_Bus &_bus;                    // bus transport
+  uint8_t _addr;                          // I2C address of the device
+  uint8_t _bufRTC[8];                     // time message is the biggest message we need to handle (7 bytes)
+  void (*_cbMux)(void *, uint8_t);        // multiplexer channel select callback
+  void *_muxCtx;                          // multiplexer callback context
+  uint8_t _muxChannel;                    // multiplexer channel for this device
   void (*_cbAlarm1)(void);
   void (*_cbAlarm2)(void);
+  void (*_cbAlarm1Ctx)(void *);   // alarm 1 callback with context
+  void (*_cbAlarm2Ctx)(void *);   // alarm 2 callback with context
+  void *_ctxAlarm1;               // alarm 1 callback context
+  void *_ctxAlarm2;               // alarm 2 callback context
+  boolean _almIntMode;            // serviceAlarms() only reads device when pending
+  volatile boolean _almPending;   // alarm interrupt received
+  void dispatchAlarm(uint8_t alarm);
 #if ENABLE_DYNAMIC_CENTURY  
   uint8_t _century;
 #endif
 
-  // BCD to binary number packing/unpacking functions
-  inline uint8_t BCD2bin(uint8_t v) { return v - 6 * (v >> 4); }
-  inline uint8_t bin2BCD (uint8_t v) { return v + 6 * (v / 10); }
-  boolean unpackAlarm(uint8_t entryPoint);
-  boolean packAlarm(uint8_t entryPoint);
+  // days from 0000-03-01 to the March 1st starting year y
+  static constexpr uint32_t daysBefore(uint32_t y) { return(y * 365 + y / 4 - y / 100 + y / 400); }
+
+  // build time parsing helpers
+  static constexpr uint8_t parse2(const char *p) { return((p[0] == ' ' ? 0 : (p[0] - '0') * 10) + p[1] - '0'); }
+  static constexpr uint8_t parseMonth(const char *p)
+  {
+    return(p[0] == 'J' ? (p[1] == 'a' ? 1 : (p[2] == 'n' ? 6 : 7)) :
+           p[0] == 'F' ? 2 :
+           p[0] == 'M' ? (p[2] == 'r' ? 3 : 5) :
+           p[0] == 'A' ? (p[1] == 'p' ? 4 : 8) :
+           p[0] == 'S' ? 9 :
+           p[0] == 'O' ? 10 :
+           p[0] == 'N' ? 11 : 12);
+  }
+  static constexpr timeData_t buildTime(uint16_t yyyy, uint8_t mm, uint8_t dd, const char *time)
+  {
+    return(timeData_t{ yyyy, mm, dd, parse2(&time[0]), parse2(&time[3]), parse2(&time[6]), calcDoW(yyyy, mm, dd), 0 });
+  }
+  static almType_t alarmType(const uint8_t *buf, uint8_t alarm);
+  static int16_t tempDecode(const uint8_t *buf);
+  static void unpackAlarm(const uint8_t *buf, uint8_t entryPoint, timeData_t &t);
+  void unpackTime(const uint8_t *buf, timeData_t &t);
+  void getFields(timeData_t &t);
+  void setFields(const timeData_t &t);
+  static void packAlarm(uint8_t *buf, uint8_t alarm, const timeData_t &t, almType_t almType, boolean mode12);
+  boolean readMode12(boolean &mode12);
+  void alarmFields(timeData_t &t, boolean mode12);
+
+#if ENABLE_SHADOW_CACHE
+  boolean _shadowEnabled;             // true if the cache is in use
+  uint32_t _shadowValid;              // one bit per valid register in _shadow
+  uint8_t _shadow[DS3231_RAM_MAX];    // copy of the device registers
+  void updateShadow(uint8_t addr, uint8_t* buf, uint8_t len);
+#endif
+  boolean readRegister(uint8_t addr, uint8_t need, uint8_t &value);
+
+  boolean _batch;           // true if control() changes are being accumulated
+  uint8_t _batchMask[2];    // bits changed in the control and status registers
+  uint8_t _batchCmd[2];     // new values for the changed bits
+
+  enum asyncOp_t { ASYNC_NONE, ASYNC_READ_TIME, ASYNC_WRITE_TIME, ASYNC_READ_SNAPSHOT };
+
+  volatile asyncOp_t _asyncOp;      // asynchronous operation in progress
+  asyncStatus_t _asyncSts;          // transport status of the asynchronous transfer
+  uint8_t _asyncBuf[8];             // register address and time data for asynchronous transfers
+  snapshot_t *_asyncSnap;           // snapshot being read asynchronously
+  void (*_cbAsync)(asyncStatus_t);  // asynchronous operation completion callback
+
+  boolean startAsync(asyncOp_t op, uint8_t addr, uint8_t wlen, uint8_t *rbuf, uint8_t rlen);
+  void packTime(uint8_t *buf, boolean mode12);
+  void decodeSnapshot(snapshot_t &snap);
+  boolean _fastEnabled;           // fast clock is enabled
+  boolean _fastValid;             // fast clock has been set from the RTC
+  boolean _fastMode12;            // RTC was in 12H mode when read
+  uint16_t _fastResync;           // seconds between resync from the RTC
+  uint32_t _fastAnchorMs;         // millis() when the fast clock was set
+  uint32_t _fastMs;               // millis() at the last whole second added to _fastTime
+  uint32_t _fastEdges;            // square wave edge count last added to _fastTime
+  boolean _fastSqw;               // square wave edges seen since the fast clock was set
+  timeData_t _fastTime;           // fast clock time in 24H format
+  volatile uint32_t _sqwCount;    // all square wave edges
+  volatile uint32_t _sqwUs;       // micros() at the last square wave edge
+
+  boolean _msValid;               // the millisecond time anchor is set
+  uint16_t _msRate;               // square wave edges per second
+  uint32_t _msEdges;              // edge count at the start of the anchor second
+  uint32_t _msSecs;               // RTC time of the anchor second
+  void sqwSnapshot(uint32_t &count, uint32_t &us);
+  boolean sqwAnchor(void);
+
+  boolean _incValid;              // _incTime holds the last time read with change tracking
+  uint8_t _incRefresh;            // seconds between forced full reads, 0 if none
+  uint32_t _incReadMs;            // millis() at the last incremental read
+  uint32_t _incFullMs;            // millis() at the last full read
+  timeData_t _incTime;            // uncorrected time from the last change tracking read
+  timeData_t _incShown;           // corrected time from the last change tracking read
+  boolean _incMode12;             // RTC was in 12H mode at the last full read
+
+  MD_DS3231_Correction *_corr;    // software time correction, nullptr if none
+  void correctTime(timeData_t &t, boolean mode12);
+  boolean _readValid;             // _readSecs is set
+  uint32_t _readSecs;             // uncorrected RTC time last read or written
+  uint32_t _readMs;               // millis() when _readSecs was read
+  void noteTimeRead(const uint8_t *buf);
+  void noteTimeWrite(const uint8_t *buf);
+  uint32_t bufSecs(const uint8_t *buf);
+
+  uint16_t _alignLatency;         // bus latency for aligned writes in us, 0 to measure
+  uint16_t _lastLatency;          // latency used by the last aligned write
+  void packTime(const timeData_t &t, uint8_t *buf, boolean mode12);
+  boolean measureWriteLatency(uint32_t &us);
+
+  enum timeCb_t { TCB_DAY, TCB_HOUR, TCB_MINUTE, TCB_SECOND, TCB_MAX };
+
+  void (*_cbTime[TCB_MAX])(void *);   // time change callbacks, in dispatch order
+  void *_ctxTime[TCB_MAX];            // context for each time change callback
+
+  inline boolean setTimeCallback(timeCb_t id, void (*cb)(void *), void *ctx) { _cbTime[id] = cb; _ctxTime[id] = ctx; return(true); };
+  uint8_t trackTime(const timeData_t &t, boolean mode12);
+
+  static void to24H(timeData_t &t);
+  static void to12H(timeData_t &t);
+  static void addSeconds(timeData_t &t, uint32_t secs);
+  static uint8_t timeChanges(const timeData_t &t1, const timeData_t &t2);
+  void fastAnchor(void);
+  void init(void);
+  void busStart(void);
 
   // Interface functions for the RTC device
   uint8_t readDevice(uint8_t addr, uint8_t* buf, uint8_t len);
@@ -0,0 +1,165 @@
+/*
+  MD_DS3231 - Library for using a DS3231 Real Time Clock.
+
+  Aging offset calibration.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+ */
+#include "MD_DS3231_AgingCal.h"
+
+MD_DS3231_AgingCal::MD_DS3231_AgingCal(MD_DS3231 &rtc, MD_DS3231_RefClock &ref) :
+_rtc(rtc), _ref(ref), _interval(600), _window(24), _stepPpb(AGINGCAL_STEP_PPB), _lastPpb(0), _adjust(0)
+{
+  restart();
+}
+
+void MD_DS3231_AgingCal::begin(uint16_t interval, uint8_t window)
+{
+  if (window == 0) window = 1;
+  if (window > AGINGCAL_MAX_WINDOW) window = AGINGCAL_MAX_WINDOW;
+  _window = window;
+
+  // make sure the window cannot hold too many samples
+  uint32_t minInterval = ((uint32_t)window * 3600UL) / (AGINGCAL_MAX_SAMPLES - 1) + 1;
+  _interval = (interval < minInterval) ? minInterval : interval;
+
+  _lastPpb = 0;
+  _adjust = 0;
+  restart();
+}
+
+void MD_DS3231_AgingCal::restart(void)
+// Start a new fitting window
+{
+  _watching = false;
+  _nextMs = 0;
+  _n = 0;
+  _rtc0 = _ref0 = 0;
+  _sx = _sy = _sxx = _sxy = 0;
+}
+
+boolean MD_DS3231_AgingCal::service(void)
+{
+  uint32_t ms, secs;
+
+  if (!_ref.read(ms))
+    return(false);
+
+  if (!_watching)
+  {
+    if (_n != 0 && (int32_t)(ms - _nextMs) < 0)
+      return(false);    // not time for the next sample
+
+    _watching = _rtc.readRawSecs(_watchSecs);
+    return(false);
+  }
+
+  if (!_rtc.readRawSecs(secs) || secs == _watchSecs)
+    return(false);
+
+  if (secs != _watchSecs + 1)   // missed the change, wait for the next one
+  {
+    _watchSecs = secs;
+    return(false);
+  }
+
+  _watching = false;
+
+  return(addSample(secs, ms));
+}
+
+boolean MD_DS3231_AgingCal::addSample(uint32_t rtcSecs, uint32_t refMs)
+{
+  if (_n == 0)
+  {
+    _rtc0 = rtcSecs;
+    _ref0 = refMs;
+  }
+
+  uint32_t dRef = refMs - _ref0;    // wraps correctly
+  int64_t x = dRef / 1000;
+  int64_t y = ((int64_t)(rtcSecs - _rtc0) * 1000) - dRef;
+
+  _sx += x;
+  _sy += y;
+  _sxx += x * x;
+  _sxy += x * y;
+  _n++;
+
+  // start watching a little early so the sample is close to the interval
+  _nextMs = refMs + (_interval * 1000UL) - 1000;
+
+  if (dRef < _window * 3600000UL && _n < AGINGCAL_MAX_SAMPLES)
+    return(false);
+
+  // window is complete
+  boolean b = false;
+  int32_t ppb;
+
+  if (fit(ppb))
+  {
+    _lastPpb = ppb;
+    b = adjust(ppb);
+  }
+  restart();
+
+  return(b);
+}
+
+boolean MD_DS3231_AgingCal::fit(int32_t &ppb)
+// Least squares slope of RTC - reference offset against elapsed time.
+// The slope in ms per second is scaled to parts per billion.
+{
+  if (_n < 3)
+    return(false);
+
+  int64_t den = (_n * _sxx) - (_sx * _sx);
+  int64_t num = (_n * _sxy) - (_sx * _sy);
+
+  if (den <= 0)
+    return(false);
+
+  // scale down so num * 1000000 cannot overflow for errors up to 1000ppm
+  while (den > (1LL << 40))
+  {
+    den /= 2;
+    num /= 2;
+  }
+  if (num > den) num = den;
+  if (num < -den) num = -den;
+
+  ppb = (int32_t)((num * 1000000LL) / den);
+
+  return(true);
+}
+
+boolean MD_DS3231_AgingCal::adjust(int32_t ppb)
+// Change the aging offset by the nearest number of steps to remove the
+// frequency error. A positive offset slows the oscillator.
+{
+  int32_t steps = (ppb + ((ppb < 0) ? -(_stepPpb / 2) : (_stepPpb / 2))) / (int32_t)_stepPpb;
+  uint8_t v;
+
+  if (steps == 0)
+    return(false);
+
+  if (_rtc.readRAM(DS3231_AGING_REG, &v, 1) != 1)
+    return(false);
+
+  int16_t aging = (int8_t)v + steps;
+
+  if (aging > 127) aging = 127;
+  if (aging < -128) aging = -128;
+  if (aging == (int8_t)v)
+    return(false);
+
+  if (!_rtc.control(DS3231_AGING_OFFSET, (uint8_t)aging))
+    return(false);
+  _rtc.startConversion();   // apply the new offset now instead of at the next conversion
+  _adjust++;
+
+  return(true);
+}
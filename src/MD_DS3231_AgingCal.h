@@ -0,0 +1,181 @@
+#ifndef MD_DS3231_AgingCal_h
+#define MD_DS3231_AgingCal_h
+
+/**
+ * \file
+ * \brief Aging offset calibration for the MD_DS3231 library
+ *
+ * The aging offset register trims the DS3231 oscillator frequency by about
+ * 0.1ppm per step. The calibration engine compares the RTC with a more accurate
+ * reference clock over hours or days, fits the frequency error by least squares,
+ * converts it to aging offset steps and writes the register. The process then
+ * starts again with the new setting, so the estimate keeps being refined.
+ *
+ * Each sample pairs the RTC time at the moment its seconds change with the
+ * reference time at that moment, so the comparison is not limited by the one
+ * second resolution of the RTC. The accuracy of each sample depends on how often
+ * service() is called while waiting for the seconds to change. The samples use
+ * the uncorrected RTC time, so a software correction set with setCorrection()
+ * does not hide the oscillator error being measured.
+ *
+ * The reference clock is any object derived from MD_DS3231_RefClock, for example
+ * a GPS or network time source. MD_DS3231_RefMillis uses millis(), which on a
+ * Linux host follows the network disciplined system clock.
+ */
+
+#include "MD_DS3231.h"
+
+#define AGINGCAL_MAX_SAMPLES  4096  ///< Samples in one fit, keeps the 64 bit sums in range
+#define AGINGCAL_MAX_WINDOW   168   ///< Longest fitting window in hours
+#define AGINGCAL_STEP_PPB     100   ///< Default frequency change per aging offset step in parts per billion
+
+/**
+ * Reference clock base class.
+ *
+ * Derive from this class to provide the reference time to the calibration.
+ */
+class MD_DS3231_RefClock
+{
+  public:
+  virtual ~MD_DS3231_RefClock(void) {};
+
+  /**
+   * Read the reference time
+   *
+   * The time is in milliseconds from any starting point and may wrap
+   * around, as only differences of less than 49 days are used.
+   *
+   * \param ms  the variable to receive the time in milliseconds.
+   * \return false if the reference is not available, true otherwise.
+   */
+  virtual boolean read(uint32_t &ms) = 0;
+};
+
+/**
+ * Reference clock using millis().
+ */
+class MD_DS3231_RefMillis : public MD_DS3231_RefClock
+{
+  public:
+  virtual boolean read(uint32_t &ms) { ms = millis(); return(true); };
+};
+
+/**
+ * Aging offset calibration engine.
+ *
+ * Samples the RTC against the reference clock every _interval_ seconds and fits
+ * the frequency error when _window_ hours of samples have been collected. If the
+ * error is at least half an aging step, the aging offset register is adjusted,
+ * a temperature conversion is started so the TCXO applies it straight away, and
+ * a new window is started.
+ */
+class MD_DS3231_AgingCal
+{
+  public:
+  /**
+   * Class Constructor
+   *
+   * \param rtc   the RTC object to calibrate.
+   * \param ref   the reference clock.
+   */
+  MD_DS3231_AgingCal(MD_DS3231 &rtc, MD_DS3231_RefClock &ref);
+
+  /**
+   * Initialize the calibration
+   *
+   * Set the sampling parameters and start a new fitting window. The interval is
+   * increased if needed so a window holds no more than AGINGCAL_MAX_SAMPLES.
+   *
+   * \param interval  the seconds between samples.
+   * \param window    the hours of samples used for each fit, up to AGINGCAL_MAX_WINDOW.
+   */
+  void begin(uint16_t interval = 600, uint8_t window = 24);
+
+  /**
+   * Set the aging offset sensitivity
+   *
+   * The change in frequency for each step of the aging offset is about 0.1ppm at
+   * 25 degrees C and varies with temperature. Later fits correct for any error.
+   *
+   * \param ppb  the frequency change per aging offset step in parts per billion.
+   */
+  inline void setStep(uint16_t ppb) { if (ppb != 0) _stepPpb = ppb; };
+
+  /**
+   * Service the calibration
+   *
+   * Call this method often from loop(). When a sample is due the method watches for
+   * the RTC seconds to change, reading the RTC on each call until they do, and
+   * records the sample. Between samples only the reference clock is read.
+   *
+   * \return true if the aging offset register was changed, false otherwise.
+   */
+  boolean service(void);
+
+  /**
+   * Add a sample
+   *
+   * Add a sample taken elsewhere, for example from an interrupt on the 1Hz square
+   * wave. The reference time must be the time at which the RTC changed to _rtcSecs_.
+   *
+   * \param rtcSecs the RTC time in seconds since 2000-01-01, just after it changed.
+   * \param refMs   the reference time in milliseconds.
+   * \return true if the aging offset register was changed, false otherwise.
+   */
+  boolean addSample(uint32_t rtcSecs, uint32_t refMs);
+
+  /**
+   * Fit the samples in the current window
+   *
+   * Work out the frequency error from the samples collected so far, without
+   * changing the aging offset. Positive values mean the RTC is running fast.
+   *
+   * \param ppb the variable to receive the frequency error in parts per billion.
+   * \return false if there are less than 3 samples, true otherwise.
+   */
+  boolean fit(int32_t &ppb);
+
+  /**
+   * Get the result of the last completed window
+   *
+   * \return the frequency error found by the last fit in parts per billion.
+   */
+  inline int32_t lastError(void) { return(_lastPpb); };
+
+  /**
+   * Get the number of samples in the current window
+   *
+   * \return the number of samples.
+   */
+  inline uint16_t samples(void) { return(_n); };
+
+  /**
+   * Get the number of times the aging offset was changed
+   *
+   * \return the number of adjustments since begin().
+   */
+  inline uint16_t adjustments(void) { return(_adjust); };
+
+  private:
+  MD_DS3231 &_rtc;          // the RTC we are calibrating
+  MD_DS3231_RefClock &_ref; // the reference clock
+  uint16_t _interval;       // seconds between samples
+  uint8_t _window;          // hours in each fitting window
+  uint16_t _stepPpb;        // ppb per aging step
+  boolean _watching;        // waiting for the RTC seconds to change
+  uint32_t _watchSecs;      // RTC seconds when watching started
+  uint32_t _nextMs;         // reference time the next sample is due
+  int32_t _lastPpb;         // result of the last fit
+  uint16_t _adjust;         // aging register changes
+
+  // least squares sums. x is reference seconds and y is RTC - reference
+  // milliseconds, both from the first sample in the window.
+  uint16_t _n;
+  uint32_t _rtc0, _ref0;    // first sample in the window
+  int64_t _sx, _sy, _sxx, _sxy;
+
+  void restart(void);
+  boolean adjust(int32_t ppb);
+};
+
+#endif
@@ -0,0 +1,132 @@
+#ifndef MD_DS3231_BCD_h
+#define MD_DS3231_BCD_h
+
+/**
+ * \file
+ * \brief BCD conversion of the time register block for the MD_DS3231 library
+ *
+ * The 7 byte time block is converted between BCD and binary either one byte at
+ * a time or a machine word at a time (SIMD within a register, SWAR). In the word
+ * conversions each byte of the word is a separate lane and the arithmetic is
+ * arranged so no carries or borrows cross lanes. 64 bit words are used on 64 bit
+ * targets and 32 bit words otherwise.
+ *
+ * The library selects one of the conversions with ENABLE_SWAR_BCD. Both are
+ * available here so the host benchmark can check and compare them. Applications
+ * do not need to include this file.
+ */
+
+#include "MD_DS3231.h"
+
+#if UINTPTR_MAX > 0xffffffffUL
+typedef uint64_t swarWord_t;  ///< Machine word used for the SWAR conversion
+#else
+typedef uint32_t swarWord_t;  ///< Machine word used for the SWAR conversion
+#endif
+
+/// \cond
+template <typename W> static inline W swarRepeat8(uint8_t v) { return((W)~(W)0 / 0xff * v); }
+template <typename W> static inline W swarRepeat16(uint16_t v) { return((W)~(W)0 / 0xffff * v); }
+
+template <typename W> static inline W swarLoad(const uint8_t *p, uint8_t n = sizeof(W))
+// Load n bytes in increasing address order into increasing lanes
+{
+  W w = 0;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  if (n == sizeof(W))
+    memcpy(&w, p, n);
+  else
+#endif
+  for (uint8_t i = 0; i < n; i++)
+    w |= (W)p[i] << (8 * i);
+
+  return(w);
+}
+
+template <typename W> static inline void swarStore(W w, uint8_t *p)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  memcpy(p, &w, sizeof(W));
+#else
+  for (uint8_t i = 0; i < sizeof(W); i++)
+    p[i] = (uint8_t)(w >> (8 * i));
+#endif
+}
+
+template <typename W> static inline W swarBCD2bin(W w)
+// bin = bcd - 6 * tens, never negative in any lane
+{
+  return(w - 6 * ((w >> 4) & swarRepeat8<W>(0x0f)));
+}
+
+template <typename W> static inline W swarBin2BCD(W w)
+// bcd = bin + 6 * (bin / 10), with bin / 10 = (bin * 103) >> 10 for bin < 100. 
+// The multiply needs 16 bits, so odd and even bytes are done separately.
+{
+  const W m8 = swarRepeat16<W>(0x00ff);
+  const W m4 = swarRepeat16<W>(0x000f);
+  W e = w & m8;
+  W o = (w >> 8) & m8;
+
+  e += 6 * (((e * 103) >> 10) & m4);
+  o += 6 * (((o * 103) >> 10) & m4);
+
+  return(e | (o << 8));
+}
+/// \endcond
+
+/**
+ * Convert the time block from BCD a byte at a time
+ *
+ * \param in    the 7 byte BCD time block.
+ * \param out   the 8 byte buffer to receive the binary values.
+ * \param mask  8 bytes of masks to remove the control bits from each byte of _in_.
+ */
+static inline void decodeBCDBytes(const uint8_t *in, uint8_t *out, const uint8_t *mask)
+{
+  for (uint8_t i = 0; i < 7; i++)
+    out[i] = MD_DS3231::BCD2bin(in[i] & mask[i]);
+}
+
+/**
+ * Convert the time block from BCD a word at a time
+ *
+ * \param in    the 7 byte BCD time block.
+ * \param out   the 8 byte buffer to receive the binary values.
+ * \param mask  8 bytes of masks to remove the control bits from each byte of _in_.
+ */
+static inline void decodeBCDWords(const uint8_t *in, uint8_t *out, const uint8_t *mask)
+{
+  for (uint8_t i = 0; i < 8; i += sizeof(swarWord_t))   // the source is only 7 bytes long
+    swarStore(swarBCD2bin(swarLoad<swarWord_t>(&in[i], i + sizeof(swarWord_t) > 7 ? 7 - i : sizeof(swarWord_t)) & swarLoad<swarWord_t>(&mask[i])), &out[i]);
+}
+
+/**
+ * Convert the time block to BCD a byte at a time
+ *
+ * \param in    the 8 byte buffer of binary values (0-99), the last one unused.
+ * \param out   the 7 byte buffer to receive the BCD time block.
+ */
+static inline void encodeBCDBytes(const uint8_t *in, uint8_t *out)
+{
+  for (uint8_t i = 0; i < 7; i++)
+    out[i] = MD_DS3231::bin2BCD(in[i]);
+}
+
+/**
+ * Convert the time block to BCD a word at a time
+ *
+ * \param in    the 8 byte buffer of binary values (0-99), the last one unused.
+ * \param out   the 7 byte buffer to receive the BCD time block.
+ */
+static inline void encodeBCDWords(const uint8_t *in, uint8_t *out)
+{
+  uint8_t b[8];
+
+  for (uint8_t i = 0; i < 8; i += sizeof(swarWord_t))
+    swarStore(swarBin2BCD(swarLoad<swarWord_t>(&in[i])), &b[i]);
+  memcpy(out, b, 7);
+}
+
+#endif
@@ -0,0 +1,727 @@
+/*
+  MD_DS3231 - Library for using a DS3231 Real Time Clock.
+
+  Bus transport implementations.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+ */
+#include "MD_DS3231_Bus.h"
+
+#ifndef ARDUINO
+#include <chrono>
+#endif
+
+#if DS3231_LINUX
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c.h>
+#include <linux/i2c-dev.h>
+#endif
+
+#ifndef ARDUINO
+// Arduino timer equivalents for a host, from the start of the program.
+// Weak so a test program can supply its own clock.
+static const std::chrono::steady_clock::time_point timeBase = std::chrono::steady_clock::now();
+
+__attribute__((weak)) unsigned long millis(void)
+{
+  return(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - timeBase).count());
+}
+
+__attribute__((weak)) unsigned long micros(void)
+{
+  return(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - timeBase).count());
+}
+#endif
+
+// Generic transport - register address write followed by a separate read
+uint8_t MD_DS3231_Bus::transaction(uint8_t dev, const uint8_t *wbuf, uint8_t wlen, uint8_t *rbuf, uint8_t rlen)
+{
+  if (write(dev, wbuf, wlen) != wlen)
+    return(0);
+
+  return(read(dev, rbuf, rlen));
+}
+
+boolean MD_DS3231_Bus::startTransaction(uint8_t dev, const uint8_t *wbuf, uint8_t wlen, uint8_t *rbuf, uint8_t rlen, asyncStatus_t &sts)
+// No background transfers - do it now and save the result for pollTransaction()
+{
+  boolean b;
+
+  if (sts == DS3231_ASYNC_BUSY)
+    return(false);
+
+  if (rlen == 0)
+    b = (write(dev, wbuf, wlen) == wlen);
+  else
+    b = (transaction(dev, wbuf, wlen, rbuf, rlen) == rlen);
+
+  sts = b ? DS3231_ASYNC_DONE : DS3231_ASYNC_ERROR;
+
+  return(true);
+}
+
+asyncStatus_t MD_DS3231_Bus::pollTransaction(asyncStatus_t &sts)
+// Report the result of the transfer once only
+{
+  asyncStatus_t s = sts;
+
+  if (s != DS3231_ASYNC_BUSY)
+    sts = DS3231_ASYNC_IDLE;
+
+  return(s);
+}
+
+#ifdef ARDUINO
+// Arduino TwoWire transport
+boolean MD_DS3231_BusWire::begin(void)
+{
+  _wire.begin();
+  return(true);
+}
+
+uint8_t MD_DS3231_BusWire::write(uint8_t dev, const uint8_t *buf, uint8_t len)
+{
+  _wire.beginTransmission(dev);
+  _wire.write(buf, len);
+  if (_wire.endTransmission() != 0)
+    return(0);
+
+  return(len);
+}
+
+uint8_t MD_DS3231_BusWire::read(uint8_t dev, uint8_t *buf, uint8_t len)
+{
+  if (_wire.requestFrom(dev, len) != len)
+    return(0);
+
+  for (uint8_t i = 0; i < len; i++) // Read the data and store it in the buffer
+    buf[i] = _wire.read();
+
+  return(len);
+}
+#endif
+
+#if DS3231_LINUX
+// Linux i2c-dev transport
+MD_DS3231_BusLinux::~MD_DS3231_BusLinux(void)
+{
+  if (_fd >= 0)
+    close(_fd);
+  pthread_mutex_destroy(&_mutex);
+}
+
+boolean MD_DS3231_BusLinux::begin(void)
+{
+  if (_fd < 0)
+    _fd = open(_device, O_RDWR);
+
+  return(_fd >= 0);
+}
+
+uint8_t MD_DS3231_BusLinux::write(uint8_t dev, const uint8_t *buf, uint8_t len)
+{
+  struct i2c_msg msg[1];
+  struct i2c_rdwr_ioctl_data xfer;
+
+  msg[0].addr = dev;
+  msg[0].flags = 0;
+  msg[0].len = len;
+  msg[0].buf = const_cast<uint8_t *>(buf);
+  xfer.msgs = msg;
+  xfer.nmsgs = 1;
+
+  if (ioctl(_fd, I2C_RDWR, &xfer) < 0)
+    return(0);
+
+  return(len);
+}
+
+uint8_t MD_DS3231_BusLinux::read(uint8_t dev, uint8_t *buf, uint8_t len)
+{
+  struct i2c_msg msg[1];
+  struct i2c_rdwr_ioctl_data xfer;
+
+  msg[0].addr = dev;
+  msg[0].flags = I2C_M_RD;
+  msg[0].len = len;
+  msg[0].buf = buf;
+  xfer.msgs = msg;
+  xfer.nmsgs = 1;
+
+  if (ioctl(_fd, I2C_RDWR, &xfer) < 0)
+    return(0);
+
+  return(len);
+}
+
+uint8_t MD_DS3231_BusLinux::transaction(uint8_t dev, const uint8_t *wbuf, uint8_t wlen, uint8_t *rbuf, uint8_t rlen)
+// Combined write/read with a repeated start between the messages
+{
+  struct i2c_msg msg[2];
+  struct i2c_rdwr_ioctl_data xfer;
+
+  msg[0].addr = dev;
+  msg[0].flags = 0;
+  msg[0].len = wlen;
+  msg[0].buf = const_cast<uint8_t *>(wbuf);
+  msg[1].addr = dev;
+  msg[1].flags = I2C_M_RD;
+  msg[1].len = rlen;
+  msg[1].buf = rbuf;
+  xfer.msgs = msg;
+  xfer.nmsgs = 2;
+
+  if (ioctl(_fd, I2C_RDWR, &xfer) < 0)
+    return(0);
+
+  return(rlen);
+}
+#endif
+
+// Traffic counting transport
+uint8_t MD_DS3231_BusStats::write(uint8_t dev, const uint8_t *buf, uint8_t len)
+{
+  _transactions++;
+  _bytes += len;
+  return(_bus.write(dev, buf, len));
+}
+
+uint8_t MD_DS3231_BusStats::read(uint8_t dev, uint8_t *buf, uint8_t len)
+{
+  _transactions++;
+  _bytes += len;
+  return(_bus.read(dev, buf, len));
+}
+
+uint8_t MD_DS3231_BusStats::transaction(uint8_t dev, const uint8_t *wbuf, uint8_t wlen, uint8_t *rbuf, uint8_t rlen)
+{
+  _transactions++;
+  _bytes += wlen + rlen;
+  return(_bus.transaction(dev, wbuf, wlen, rbuf, rlen));
+}
+
+boolean MD_DS3231_BusStats::startTransaction(uint8_t dev, const uint8_t *wbuf, uint8_t wlen, uint8_t *rbuf, uint8_t rlen, asyncStatus_t &sts)
+{
+  _transactions++;
+  _bytes += wlen + rlen;
+  return(_bus.startTransaction(dev, wbuf, wlen, rbuf, rlen, sts));
+}
+
+// In-memory register file transport
+MD_DS3231_BusMemory::MD_DS3231_BusMemory(uint8_t dev) : _dev(dev), _ptr(0), 
+_latency(0), _pending(0), _pendDev(0), _pendWBuf(nullptr), _pendWLen(0), _pendRBuf(nullptr), _pendRLen(0), _pendSts(nullptr)
+{
+  memset(_reg, 0, sizeof(_reg));
+#if DS3231_LINUX
+  pthread_mutex_init(&_mutex, nullptr);
+#endif
+}
+
+uint8_t MD_DS3231_BusMemory::write(uint8_t dev, const uint8_t *buf, uint8_t len)
+{
+  if (dev != _dev || len == 0)
+    return(0);
+
+  _ptr = buf[0] % DS3231_RAM_MAX;   // first byte is the register address
+  for (uint8_t i = 1; i < len; i++)
+  {
+    writeRegister(_ptr, buf[i]);
+    _ptr = (_ptr + 1) % DS3231_RAM_MAX;
+  }
+
+  return(len);
+}
+
+uint8_t MD_DS3231_BusMemory::read(uint8_t dev, uint8_t *buf, uint8_t len)
+{
+  if (dev != _dev)
+    return(0);
+
+  for (uint8_t i = 0; i < len; i++)
+  {
+    buf[i] = readRegister(_ptr);
+    _ptr = (_ptr + 1) % DS3231_RAM_MAX;
+  }
+
+  return(len);
+}
+
+boolean MD_DS3231_BusMemory::startTransaction(uint8_t dev, const uint8_t *wbuf, uint8_t wlen, uint8_t *rbuf, uint8_t rlen, asyncStatus_t &sts)
+// Save the transfer parameters and execute them after the simulated latency.
+// There is one simulated bus, so only one transfer can be in progress.
+{
+  if (_latency == 0)
+    return(MD_DS3231_Bus::startTransaction(dev, wbuf, wlen, rbuf, rlen, sts));
+
+  if (_pendSts != nullptr || sts == DS3231_ASYNC_BUSY)
+    return(false);
+
+  _pendDev = dev;
+  _pendWBuf = wbuf;
+  _pendWLen = wlen;
+  _pendRBuf = rbuf;
+  _pendRLen = rlen;
+  _pendSts = &sts;
+  _pending = _latency;
+  sts = DS3231_ASYNC_BUSY;
+
+  return(true);
+}
+
+asyncStatus_t MD_DS3231_BusMemory::pollTransaction(asyncStatus_t &sts)
+// Only polls for the transfer in progress count towards its latency
+{
+  if (_pendSts == &sts && --_pending == 0)
+  {
+    _pendSts = nullptr;
+    sts = DS3231_ASYNC_IDLE;
+    MD_DS3231_Bus::startTransaction(_pendDev, _pendWBuf, _pendWLen, _pendRBuf, _pendRLen, sts);
+  }
+
+  return(MD_DS3231_Bus::pollTransaction(sts));
+}
+
+// Behavioral device simulator transport
+// Register addresses and bits
+#define SIM_SEC     0x00
+#define SIM_MIN     0x01
+#define SIM_HR      0x02
+#define SIM_DAY     0x03
+#define SIM_DATE    0x04
+#define SIM_MON     0x05
+#define SIM_YR      0x06
+#define SIM_ALM1    0x07
+#define SIM_ALM2    0x0b
+#define SIM_CTL     0x0e
+#define SIM_STS     0x0f
+#define SIM_AGING   0x10
+#define SIM_TEMP    0x11
+
+#define SIM_HR_12H    0x40
+#define SIM_HR_PM     0x20
+#define SIM_MON_100   0x80
+#define SIM_ALM_MASK  0x80
+#define SIM_ALM_DY    0x40
+#define SIM_CTL_CONV  0x20
+#define SIM_CTL_INTCN 0x04
+#define SIM_CTL_A2IE  0x02
+#define SIM_CTL_A1IE  0x01
+#define SIM_STS_OSF   0x80
+#define SIM_STS_BSY   0x04
+#define SIM_STS_A2F   0x02
+#define SIM_STS_A1F   0x01
+
+#define SIM_AGING_PPB 100     // frequency change for each aging offset step, in parts per billion
+
+static inline uint8_t simBCD2bin(uint8_t v) { return(v - 6 * (v >> 4)); }
+static inline uint8_t simBin2BCD(uint8_t v) { return(v + 6 * (v / 10)); }
+
+MD_DS3231_BusSim::MD_DS3231_BusSim(uint8_t dev) : MD_DS3231_BusMemory(dev),
+_realTime(true), _timeScale(1), _subMs(0), _autoConv(64), _convTime(125), _convMs(0), _temperature(25 * 4),
+_freqError(0), _aging(0), _driftAcc(0)
+{
+  // power on register values
+  _reg[SIM_DAY] = 0x01;
+  _reg[SIM_DATE] = 0x01;
+  _reg[SIM_MON] = 0x01;
+  _reg[SIM_CTL] = 0x1c;   // RS2, RS1, INTCN
+  _reg[SIM_STS] = 0x88;   // OSF, EN32KHZ
+  _reg[SIM_TEMP] = _temperature >> 2;
+  _reg[SIM_TEMP + 1] = (_temperature & 3) << 6;
+  _lastMs = millis();
+}
+
+uint8_t MD_DS3231_BusSim::write(uint8_t dev, const uint8_t *buf, uint8_t len)
+{
+  update();
+  return(MD_DS3231_BusMemory::write(dev, buf, len));
+}
+
+uint8_t MD_DS3231_BusSim::read(uint8_t dev, uint8_t *buf, uint8_t len)
+{
+  update();
+  return(MD_DS3231_BusMemory::read(dev, buf, len));
+}
+
+void MD_DS3231_BusSim::setRealTime(boolean b)
+{
+  _realTime = b;
+  _lastMs = millis();
+}
+
+void MD_DS3231_BusSim::update(void)
+// Catch up with the host clock
+{
+  if (_realTime)
+  {
+    uint32_t now = millis();
+
+    advance((now - _lastMs) * _timeScale);
+    _lastMs = now;
+  }
+}
+
+int32_t MD_DS3231_BusSim::frequencyError(void)
+{
+  return(_freqError - (_aging * (int32_t)SIM_AGING_PPB));
+}
+
+uint32_t MD_DS3231_BusSim::driftMs(uint32_t ms)
+// Convert real milliseconds to device milliseconds, carrying the fraction
+{
+  const int32_t PPB = 1000000000L;
+  int32_t err = frequencyError();
+
+  if (err == 0)
+    return(ms);
+
+  _driftAcc += (int64_t)ms * err;
+
+  int64_t extra = _driftAcc / PPB;
+
+  if (extra < 0 && (uint64_t)-extra > ms)
+    extra = -(int64_t)ms;
+  _driftAcc -= extra * PPB;
+
+  return(ms + extra);
+}
+
+void MD_DS3231_BusSim::advance(uint32_t ms)
+{
+  ms = driftMs(ms);
+
+  while (ms != 0)
+  {
+    if (_subMs == 0 && _convMs == 0 && ms >= 1000)
+    {
+      // whole seconds can be done in bulk
+      uint32_t n = ms / 1000;
+
+      advanceSeconds(n, false);
+      ms -= n * 1000;
+      continue;
+    }
+
+    // step to the next event: end of conversion or end of second
+    uint32_t step = 1000 - _subMs;
+
+    if (_convMs != 0 && _convMs < step) step = _convMs;
+    if (ms < step) step = ms;
+
+    ms -= step;
+    _subMs += step;
+    if (_convMs != 0)
+    {
+      _convMs -= step;
+      if (_convMs == 0) endConversion();
+    }
+
+    if (_subMs == 1000)
+    {
+      _subMs = 0;
+      tickSecond();
+    }
+  }
+}
+
+boolean MD_DS3231_BusSim::intPin(void)
+{
+  update();
+
+  if (_reg[SIM_CTL] & SIM_CTL_INTCN)
+    return(!((_reg[SIM_CTL] & _reg[SIM_STS]) & (SIM_CTL_A1IE | SIM_CTL_A2IE)));
+
+  return(_subMs >= 500);   // 1Hz square wave, falling edge at the start of the second
+}
+
+uint8_t MD_DS3231_BusSim::readRegister(uint8_t addr)
+{
+  return(_reg[addr]);
+}
+
+void MD_DS3231_BusSim::writeRegister(uint8_t addr, uint8_t value)
+{
+  switch (addr)
+  {
+  case SIM_SEC:
+    _reg[addr] = value;
+    _subMs = 0;     // the countdown chain restarts when the seconds are written
+    break;
+
+  case SIM_CTL:
+    // CONV stays set until the conversion ends, setting it starts one
+    _reg[addr] = (value & ~SIM_CTL_CONV) | (_reg[addr] & SIM_CTL_CONV);
+    if (value & SIM_CTL_CONV)
+    {
+      _reg[addr] |= SIM_CTL_CONV;
+      if (_convMs == 0) startConversion();
+    }
+    break;
+
+  case SIM_STS:
+    // OSF, A2F and A1F can only be cleared, EN32KHZ is read/write, BSY is read only
+    _reg[addr] = (_reg[addr] & value & (SIM_STS_OSF | SIM_STS_A2F | SIM_STS_A1F)) | (value & 0x08) | (_reg[addr] & SIM_STS_BSY);
+    break;
+
+  case SIM_TEMP:
+  case SIM_TEMP + 1:
+    break;    // read only
+
+  default:
+    _reg[addr] = value;
+    break;
+  }
+}
+
+uint32_t MD_DS3231_BusSim::advanceToAlarm(uint32_t maxSecs)
+{
+  update();
+  _subMs = 0;
+
+  return(advanceSeconds(maxSecs, true));
+}
+
+uint32_t MD_DS3231_BusSim::advanceSeconds(uint32_t secs, boolean toAlarm)
+// Advance whole seconds, skipping periods where no alarm can match. 
+// Return the number of seconds advanced.
+{
+  uint32_t done = 0;
+
+  while (done < secs)
+  {
+    uint32_t n;
+
+    if (_convMs != 0) endConversion();   // a conversion ends within the second
+
+    // skip the seconds where no alarm can match, without crossing midnight
+    n = secondsToSkip();
+    if (n > secs - done) n = secs - done;
+    if (n != 0)
+    {
+      setTimeOfDay(timeOfDay() + n);
+      if (n >= _autoConv)
+      {
+        endConversion();    // at least one automatic conversion in the skipped time
+        _autoConv = 64 - ((n - _autoConv) % 64);
+      }
+      else
+        _autoConv -= n;
+      done += n;
+      continue;
+    }
+
+    // process the next second normally
+    done++;
+    if (tickSecond() && toAlarm)
+      break;
+  }
+
+  return(done);
+}
+
+uint32_t MD_DS3231_BusSim::secondsToSkip(void)
+// Number of seconds following the current one that can be skipped, 
+// up to the end of the current minute, hour or day.
+{
+  uint32_t sod = timeOfDay();
+
+  if (!alarmPossible(2)) return(86399 - sod);
+  if (!alarmPossible(1)) return(3599 - (sod % 3600));
+  if (!alarmPossible(0)) return(59 - (sod % 60));
+
+  return(0);
+}
+
+boolean MD_DS3231_BusSim::alarmPossible(uint8_t level)
+// Check if an alarm could match in the rest of the current minute (level 0),
+// hour (level 1) or day (level 2). The fields that stay the same in the period 
+// must match unless masked.
+{
+  const uint8_t *a1 = &_reg[SIM_ALM1];
+  const uint8_t *a2 = &_reg[SIM_ALM2];
+  boolean day1, day2;
+
+  day1 = (a1[3] & SIM_ALM_MASK) || (a1[3] & 0x3f) == ((a1[3] & SIM_ALM_DY) ? _reg[SIM_DAY] & 0x0f : _reg[SIM_DATE] & 0x3f);
+  day2 = (a2[2] & SIM_ALM_MASK) || (a2[2] & 0x3f) == ((a2[2] & SIM_ALM_DY) ? _reg[SIM_DAY] & 0x0f : _reg[SIM_DATE] & 0x3f);
+  if (level == 2)
+    return(day1 || day2);
+
+  day1 = day1 && ((a1[2] & SIM_ALM_MASK) || (a1[2] & 0x7f) == (_reg[SIM_HR] & 0x7f));
+  day2 = day2 && ((a2[1] & SIM_ALM_MASK) || (a2[1] & 0x7f) == (_reg[SIM_HR] & 0x7f));
+  if (level == 1)
+    return(day1 || day2);
+
+  // Alarm 2 only matches at 00 seconds, which is the start of the next minute
+  return(day1 && ((a1[1] & SIM_ALM_MASK) || (a1[1] & 0x7f) == (_reg[SIM_MIN] & 0x7f)) &&
+         ((a1[0] & SIM_ALM_MASK) || (a1[0] & 0x7f) > (_reg[SIM_SEC] & 0x7f)));
+}
+
+uint32_t MD_DS3231_BusSim::timeOfDay(void)
+// Seconds since midnight from the time registers
+{
+  uint8_t h;
+
+  if (_reg[SIM_HR] & SIM_HR_12H)
+  {
+    h = simBCD2bin(_reg[SIM_HR] & 0x1f) % 12;
+    if (_reg[SIM_HR] & SIM_HR_PM) h += 12;
+  }
+  else
+    h = simBCD2bin(_reg[SIM_HR] & 0x3f);
+
+  return((h * 60UL + simBCD2bin(_reg[SIM_MIN] & 0x7f)) * 60 + simBCD2bin(_reg[SIM_SEC] & 0x7f));
+}
+
+void MD_DS3231_BusSim::setTimeOfDay(uint32_t sod)
+// Set the time registers to seconds since midnight
+{
+  uint8_t h = sod / 3600;
+
+  _reg[SIM_SEC] = simBin2BCD(sod % 60);
+  _reg[SIM_MIN] = simBin2BCD((sod / 60) % 60);
+  if (_reg[SIM_HR] & SIM_HR_12H)
+    _reg[SIM_HR] = SIM_HR_12H | (h >= 12 ? SIM_HR_PM : 0) | simBin2BCD(h % 12 == 0 ? 12 : h % 12);
+  else
+    _reg[SIM_HR] = simBin2BCD(h);
+}
+
+boolean MD_DS3231_BusSim::tickSecond(void)
+{
+  boolean b;
+
+  incrementTime();
+  b = checkAlarms();
+
+  if (--_autoConv == 0)
+  {
+    _autoConv = 64;
+    if (_convMs == 0) startConversion();
+  }
+
+  return(b);
+}
+
+void MD_DS3231_BusSim::incrementTime(void)
+// Increment the time registers by one second with carry, as the device does
+{
+  uint8_t v, max;
+
+  v = simBCD2bin(_reg[SIM_SEC] & 0x7f) + 1;
+  _reg[SIM_SEC] = simBin2BCD(v % 60);
+  if (v < 60) return;
+
+  v = simBCD2bin(_reg[SIM_MIN] & 0x7f) + 1;
+  _reg[SIM_MIN] = simBin2BCD(v % 60);
+  if (v < 60) return;
+
+  if (_reg[SIM_HR] & SIM_HR_12H)
+  {
+    // 12:xx is the first hour of each half day, 11PM to 12AM is a new day
+    uint8_t pm = _reg[SIM_HR] & SIM_HR_PM;
+
+    v = simBCD2bin(_reg[SIM_HR] & 0x1f);
+    if (v == 11) pm ^= SIM_HR_PM;
+    v = (v % 12) + 1;
+    _reg[SIM_HR] = SIM_HR_12H | pm | simBin2BCD(v);
+    if (v != 12 || pm) return;
+  }
+  else
+  {
+    v = simBCD2bin(_reg[SIM_HR] & 0x3f) + 1;
+    _reg[SIM_HR] = simBin2BCD(v % 24);
+    if (v < 24) return;
+  }
+
+  _reg[SIM_DAY] = (_reg[SIM_DAY] & 0x07) % 7 + 1;
+
+  // month lengths, with the device leap year rule
+  uint8_t yr = simBCD2bin(_reg[SIM_YR]);
+  uint8_t mon = simBCD2bin(_reg[SIM_MON] & 0x1f);
+
+  if (mon == 2)
+    max = (yr % 4 == 0) ? 29 : 28;
+  else
+    max = 30 + ((mon + (mon >> 3)) & 1);
+
+  v = simBCD2bin(_reg[SIM_DATE] & 0x3f) + 1;
+  if (v <= max)
+  {
+    _reg[SIM_DATE] = simBin2BCD(v);
+    return;
+  }
+  _reg[SIM_DATE] = 0x01;
+
+  uint8_t century = _reg[SIM_MON] & SIM_MON_100;
+  if (++mon <= 12)
+  {
+    _reg[SIM_MON] = century | simBin2BCD(mon);
+    return;
+  }
+
+  // new year, rolling over the century
+  if (++yr > 99)
+  {
+    yr = 0;
+    century ^= SIM_MON_100;
+  }
+  _reg[SIM_MON] = century | 0x01;
+  _reg[SIM_YR] = simBin2BCD(yr);
+}
+
+boolean MD_DS3231_BusSim::checkAlarms(void)
+// Compare the alarm registers with the time, each register taking part 
+// in the match unless its mask bit is set. Return true if either matched.
+{
+  const uint8_t *a;
+  uint8_t dd;
+  boolean b = false;
+
+  // Alarm 1: seconds, minutes, hours, day/date
+  a = &_reg[SIM_ALM1];
+  dd = (a[3] & SIM_ALM_DY) ? _reg[SIM_DAY] & 0x0f : _reg[SIM_DATE] & 0x3f;
+  if (((a[0] & SIM_ALM_MASK) || (a[0] & 0x7f) == (_reg[SIM_SEC] & 0x7f)) &&
+      ((a[1] & SIM_ALM_MASK) || (a[1] & 0x7f) == (_reg[SIM_MIN] & 0x7f)) &&
+      ((a[2] & SIM_ALM_MASK) || (a[2] & 0x7f) == (_reg[SIM_HR] & 0x7f)) &&
+      ((a[3] & SIM_ALM_MASK) || (a[3] & 0x3f) == dd))
+  {
+    _reg[SIM_STS] |= SIM_STS_A1F;
+    b = true;
+  }
+
+  // Alarm 2: minutes, hours, day/date at 00 seconds
+  if (_reg[SIM_SEC] != 0)
+    return(b);
+
+  a = &_reg[SIM_ALM2];
+  dd = (a[2] & SIM_ALM_DY) ? _reg[SIM_DAY] & 0x0f : _reg[SIM_DATE] & 0x3f;
+  if (((a[0] & SIM_ALM_MASK) || (a[0] & 0x7f) == (_reg[SIM_MIN] & 0x7f)) &&
+      ((a[1] & SIM_ALM_MASK) || (a[1] & 0x7f) == (_reg[SIM_HR] & 0x7f)) &&
+      ((a[2] & SIM_ALM_MASK) || (a[2] & 0x3f) == dd))
+  {
+    _reg[SIM_STS] |= SIM_STS_A2F;
+    b = true;
+  }
+
+  return(b);
+}
+
+void MD_DS3231_BusSim::startConversion(void)
+{
+  _reg[SIM_STS] |= SIM_STS_BSY;
+  _convMs = _convTime;
+  if (_convMs == 0) endConversion();
+}
+
+void MD_DS3231_BusSim::endConversion(void)
+{
+  _reg[SIM_TEMP] = (uint8_t)(_temperature >> 2);    // two's complement whole degrees
+  _reg[SIM_TEMP + 1] = (_temperature & 3) << 6;     // fraction in the top 2 bits
+  _reg[SIM_CTL] &= ~SIM_CTL_CONV;
+  _reg[SIM_STS] &= ~SIM_STS_BSY;
+  _aging = (int8_t)_reg[SIM_AGING];                 // the TCXO uses the new aging offset
+}
@@ -0,0 +1,563 @@
+#ifndef MD_DS3231_Bus_h
+#define MD_DS3231_Bus_h
+
+/**
+ * \file
+ * \brief Bus transport definitions for the MD_DS3231 library
+ *
+ * The MD_DS3231 class talks to the device through an object derived from
+ * MD_DS3231_Bus. This allows the same library code to run on the Arduino
+ * TwoWire interface, a Linux i2c-dev device or an in-memory register file.
+ */
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#include <Wire.h>
+#else
+// Minimal set of Arduino definitions used by the library when built on a host
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+typedef bool boolean;   ///< Arduino boolean type
+
+#define PROGMEM                   ///< No separate program memory on a host
+#define memcpy_P(d, s, n)  memcpy((d), (s), (n))  ///< PROGMEM copy maps to memcpy on a host
+#define pgm_read_byte(p)   (*(const uint8_t *)(p))  ///< PROGMEM read maps to a memory read on a host
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01) ///< Arduino bitRead() equivalent
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))  ///< Arduino bitSet() equivalent
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))  ///< Arduino bitClear() equivalent
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit)) ///< Arduino bitWrite() equivalent
+#define noInterrupts()        ///< No interrupts to disable on a host
+#define interrupts()          ///< No interrupts to enable on a host
+
+// Weak definitions, so a host test can replace them with a simulated clock
+unsigned long millis(void);   ///< Milliseconds from a steady clock, Arduino millis() equivalent
+unsigned long micros(void);   ///< Microseconds from a steady clock, Arduino micros() equivalent
+#endif
+
+#if defined(__linux__) && !defined(ARDUINO)
+#define DS3231_LINUX 1  ///< Building for a Linux host
+#include <pthread.h>
+#else
+#define DS3231_LINUX 0  ///< Not building for a Linux host
+#endif
+
+// Device parameters
+#define DS3231_ID        ((uint8_t)0x68) ///< I2C/TWI device address, coded into the device
+#define DS3231_RAM_MAX   19              ///< Total number of RAM registers that can be read from the device
+#define DS3231_AGING_REG ((uint8_t)0x10) ///< Address of the aging offset register, for readRAM()
+
+/**
+  * Asynchronous transfer status enumerated type.
+  *
+  * This enumerated type is returned when polling the progress of an 
+  * asynchronous transfer.
+  */
+enum asyncStatus_t
+{
+ DS3231_ASYNC_IDLE,   ///< No transfer has been started
+ DS3231_ASYNC_BUSY,   ///< The transfer is still in progress
+ DS3231_ASYNC_DONE,   ///< The transfer completed successfully
+ DS3231_ASYNC_ERROR,  ///< The transfer failed
+};
+
+/**
+ * Abstract bus transport for the MD_DS3231 library.
+ *
+ * A transport moves raw bytes to and from an I2C device address. Derived classes
+ * implement begin(), write() and read() for the specific hardware. The transaction()
+ * method is used by the library to address a register and read from it. The default
+ * implementation is a write() followed by a read(), but transports that support a
+ * combined (repeated start) transfer should override it.
+ */
+class MD_DS3231_Bus
+{
+  public:
+  /**
+   * Class constructor
+   */
+  MD_DS3231_Bus(void) {};
+
+  /**
+   * Class destructor
+   */
+  virtual ~MD_DS3231_Bus(void) {};
+
+  /**
+   * Initialize the bus hardware
+   *
+   * \return false if errors, true otherwise.
+   */
+  virtual boolean begin(void) = 0;
+
+  /**
+   * Write data to the device
+   *
+   * Send _len_ bytes from _buf_ to the device at address _dev_ in one transfer.
+   *
+   * \param dev  the I2C address of the device.
+   * \param buf  the data to send.
+   * \param len  the number of bytes to send.
+   * \return number of bytes successfully written.
+   */
+  virtual uint8_t write(uint8_t dev, const uint8_t *buf, uint8_t len) = 0;
+
+  /**
+   * Read data from the device
+   *
+   * Read _len_ bytes into _buf_ from the device at address _dev_ in one transfer.
+   *
+   * \param dev  the I2C address of the device.
+   * \param buf  the receiving buffer.
+   * \param len  the number of bytes to read.
+   * \return number of bytes successfully read.
+   */
+  virtual uint8_t read(uint8_t dev, uint8_t *buf, uint8_t len) = 0;
+
+  /**
+   * Write then read data in one bus transaction
+   *
+   * Send _wlen_ bytes from _wbuf_ to the device and then read _rlen_ bytes
+   * back into _rbuf_.
+   *
+   * \param dev   the I2C address of the device.
+   * \param wbuf  the data to send.
+   * \param wlen  the number of bytes to send.
+   * \param rbuf  the receiving buffer.
+   * \param rlen  the number of bytes to read.
+   * \return number of bytes successfully read.
+   */
+  virtual uint8_t transaction(uint8_t dev, const uint8_t *wbuf, uint8_t wlen, uint8_t *rbuf, uint8_t rlen);
+
+  /**
+   * Start an asynchronous write then read transaction
+   *
+   * Start the transfer and return without waiting for it to finish. The buffers
+   * and _sts_ must remain valid until pollTransaction() reports the end of the 
+   * transfer. The status of the transfer is kept in _sts_, which belongs to the 
+   * caller, so callers sharing the transport each see their own result.
+   * If _rlen_ is zero only the write is performed. The default implementation 
+   * completes the transfer synchronously before returning, for transports that 
+   * cannot run in the background.
+   *
+   * \sa pollTransaction() method
+   *
+   * \param dev   the I2C address of the device.
+   * \param wbuf  the data to send.
+   * \param wlen  the number of bytes to send.
+   * \param rbuf  the receiving buffer.
+   * \param rlen  the number of bytes to read.
+   * \param sts   the status of the transfer, updated by the transport.
+   * \return false if the transfer could not be started, true otherwise.
+   */
+  virtual boolean startTransaction(uint8_t dev, const uint8_t *wbuf, uint8_t wlen, uint8_t *rbuf, uint8_t rlen, asyncStatus_t &sts);
+
+  /**
+   * Check the progress of an asynchronous transaction
+   *
+   * \sa startTransaction() method
+   *
+   * \param sts  the status passed to startTransaction().
+   * \return DS3231_ASYNC_BUSY while the transfer is in progress, then 
+   * DS3231_ASYNC_DONE or DS3231_ASYNC_ERROR once when it finishes.
+   */
+  virtual asyncStatus_t pollTransaction(asyncStatus_t &sts);
+
+  /**
+   * Lock the transport for exclusive use
+   *
+   * The library locks the transport around each transfer, including any
+   * multiplexer channel selection. Transports that may be shared between 
+   * threads override lock() and unlock(). The default does nothing.
+   *
+   * \sa unlock() method
+   */
+  virtual void lock(void) {};
+
+  /**
+   * Release the transport lock
+   *
+   * \sa lock() method
+   */
+  virtual void unlock(void) {};
+};
+
+#ifdef ARDUINO
+/**
+ * Bus transport using the Arduino TwoWire interface.
+ */
+class MD_DS3231_BusWire : public MD_DS3231_Bus
+{
+  public:
+  /**
+   * Class Constructor
+   *
+   * \param wire  the TwoWire object to use (eg, Wire).
+   */
+  MD_DS3231_BusWire(TwoWire &wire) : _wire(wire) {};
+
+  virtual boolean begin(void);
+  virtual uint8_t write(uint8_t dev, const uint8_t *buf, uint8_t len);
+  virtual uint8_t read(uint8_t dev, uint8_t *buf, uint8_t len);
+
+  private:
+  TwoWire &_wire;
+};
+#endif
+
+#if DS3231_LINUX
+/**
+ * Bus transport using a Linux i2c-dev device (eg, /dev/i2c-1).
+ *
+ * Register reads are executed as a combined I2C_RDWR transfer with a
+ * repeated start between the address write and the data read.
+ */
+class MD_DS3231_BusLinux : public MD_DS3231_Bus
+{
+  public:
+  /**
+   * Class Constructor
+   *
+   * \param device  the path to the i2c-dev device node.
+   */
+  MD_DS3231_BusLinux(const char *device) : _device(device), _fd(-1) { pthread_mutex_init(&_mutex, nullptr); };
+
+  /**
+   * Class destructor
+   *
+   * Closes the device node if it is open.
+   */
+  virtual ~MD_DS3231_BusLinux(void);
+
+  virtual boolean begin(void);
+  virtual uint8_t write(uint8_t dev, const uint8_t *buf, uint8_t len);
+  virtual uint8_t read(uint8_t dev, uint8_t *buf, uint8_t len);
+  virtual uint8_t transaction(uint8_t dev, const uint8_t *wbuf, uint8_t wlen, uint8_t *rbuf, uint8_t rlen);
+  virtual void lock(void) { pthread_mutex_lock(&_mutex); };
+  virtual void unlock(void) { pthread_mutex_unlock(&_mutex); };
+
+  private:
+  const char *_device;
+  int _fd;
+  pthread_mutex_t _mutex;
+};
+#endif
+
+/**
+ * Bus transport that counts the traffic passed to another transport.
+ *
+ * All calls are forwarded to the wrapped transport. Each write(), read(), 
+ * transaction() or startTransaction() call counts as one transaction, 
+ * and the bytes counted are those written plus those read, including 
+ * the register address byte. This makes the bus cost of each library 
+ * method visible for profiling and regression checks.
+ */
+class MD_DS3231_BusStats : public MD_DS3231_Bus
+{
+  public:
+  /**
+   * Class Constructor
+   *
+   * \param bus  the transport to wrap.
+   */
+  MD_DS3231_BusStats(MD_DS3231_Bus &bus) : _bus(bus), _transactions(0), _bytes(0) {};
+
+  virtual boolean begin(void) { return(_bus.begin()); };
+  virtual uint8_t write(uint8_t dev, const uint8_t *buf, uint8_t len);
+  virtual uint8_t read(uint8_t dev, uint8_t *buf, uint8_t len);
+  virtual uint8_t transaction(uint8_t dev, const uint8_t *wbuf, uint8_t wlen, uint8_t *rbuf, uint8_t rlen);
+  virtual boolean startTransaction(uint8_t dev, const uint8_t *wbuf, uint8_t wlen, uint8_t *rbuf, uint8_t rlen, asyncStatus_t &sts);
+  virtual asyncStatus_t pollTransaction(asyncStatus_t &sts) { return(_bus.pollTransaction(sts)); };
+  virtual void lock(void) { _bus.lock(); };
+  virtual void unlock(void) { _bus.unlock(); };
+
+  /**
+   * Get the number of transactions since the last reset()
+   *
+   * \return the transaction count.
+   */
+  inline uint32_t transactions(void) { return(_transactions); };
+
+  /**
+   * Get the number of bytes transferred since the last reset()
+   *
+   * \return the byte count.
+   */
+  inline uint32_t bytes(void) { return(_bytes); };
+
+  /**
+   * Reset the transaction and byte counters to zero
+   */
+  inline void reset(void) { _transactions = _bytes = 0; };
+
+  private:
+  MD_DS3231_Bus &_bus;
+  uint32_t _transactions;
+  uint32_t _bytes;
+};
+
+/**
+ * Bus transport backed by an in-memory DS3231 register file.
+ *
+ * The register file behaves like the device register pointer: the first byte
+ * of a write sets the register address and subsequent bytes are stored with
+ * auto-increment, wrapping after the last register. Reads continue from the
+ * current register address.
+ */
+class MD_DS3231_BusMemory : public MD_DS3231_Bus
+{
+  public:
+  /**
+   * Class Constructor
+   *
+   * \param dev  the I2C address the register file answers to.
+   */
+  MD_DS3231_BusMemory(uint8_t dev = DS3231_ID);
+
+  virtual boolean begin(void) { return(true); };
+  virtual uint8_t write(uint8_t dev, const uint8_t *buf, uint8_t len);
+  virtual uint8_t read(uint8_t dev, uint8_t *buf, uint8_t len);
+  virtual boolean startTransaction(uint8_t dev, const uint8_t *wbuf, uint8_t wlen, uint8_t *rbuf, uint8_t rlen, asyncStatus_t &sts);
+  virtual asyncStatus_t pollTransaction(asyncStatus_t &sts);
+
+  /**
+   * Set the simulated latency for asynchronous transfers
+   *
+   * An asynchronous transfer started with startTransaction() only completes 
+   * after pollTransaction() has been called the specified number of times. 
+   * This simulates a transfer running in the background on a real bus.
+   *
+   * \param polls  the number of polls before the transfer completes.
+   */
+  inline void setLatency(uint8_t polls) { _latency = polls; };
+
+#if DS3231_LINUX
+  virtual void lock(void) { pthread_mutex_lock(&_mutex); };
+  virtual void unlock(void) { pthread_mutex_unlock(&_mutex); };
+#endif
+
+  /**
+   * Direct read access to the register file, bypassing the bus.
+   *
+   * \param addr  the register address.
+   * \return the register value.
+   */
+  inline uint8_t peek(uint8_t addr) { return(_reg[addr % DS3231_RAM_MAX]); };
+
+  /**
+   * Direct write access to the register file, bypassing the bus.
+   *
+   * \param addr  the register address.
+   * \param value the new register value.
+   */
+  inline void poke(uint8_t addr, uint8_t value) { _reg[addr % DS3231_RAM_MAX] = value; };
+
+  protected:
+  /**
+   * Read one register on behalf of the bus master
+   *
+   * Derived classes can override this to model device behavior.
+   *
+   * \param addr  the register address.
+   * \return the register value.
+   */
+  virtual uint8_t readRegister(uint8_t addr) { return(_reg[addr]); };
+
+  /**
+   * Write one register on behalf of the bus master
+   *
+   * Derived classes can override this to model device behavior.
+   *
+   * \param addr  the register address.
+   * \param value the new register value.
+   */
+  virtual void writeRegister(uint8_t addr, uint8_t value) { _reg[addr] = value; };
+
+  uint8_t _reg[DS3231_RAM_MAX];  ///< the register file
+  uint8_t _dev;                  ///< the I2C address we answer to
+  uint8_t _ptr;                  ///< the current register pointer
+
+  private:
+  uint8_t _latency;     // polls needed for an asynchronous transfer
+  uint8_t _pending;     // polls remaining for the current transfer
+  uint8_t _pendDev;     // saved parameters for the current transfer
+  const uint8_t *_pendWBuf;
+  uint8_t _pendWLen;
+  uint8_t *_pendRBuf;
+  uint8_t _pendRLen;
+  asyncStatus_t *_pendSts;  // status of the current transfer, nullptr if none
+#if DS3231_LINUX
+  pthread_mutex_t _mutex;
+#endif
+};
+
+/**
+ * Bus transport simulating the behavior of a DS3231 device.
+ *
+ * The simulator adds device behavior to the in-memory register file, so the 
+ * library and application logic can be tested on a host without hardware:
+ * - The time registers count seconds with carry into the minutes, hours, day, 
+ * date, month, year and century, in 12 or 24 hour mode. As in the device, years 
+ * divisible by 4 are leap years, so year 2100 (century bit set) is a leap year.
+ * - Each second the alarm registers are compared with the time, using the mask
+ * and DY/DT bits, and A1F or A2F is set on a match.
+ * - The INT/SQW pin is asserted when INTCN is set and an enabled alarm flag is set.
+ * With INTCN clear the pin outputs the 1Hz square wave.
+ * - Setting CONV, and every 64 seconds automatically, a temperature conversion 
+ * sets BSY, then loads the temperature registers and clears CONV and BSY.
+ * - Alarm and OSF flags can only be cleared, BSY and the temperature registers 
+ * are read only, and writing the seconds register restarts the current second.
+ *
+ * By default simulated time follows the host millis() clock and is updated at the 
+ * start of each bus transfer. setTimeScale() runs the simulated clock faster than 
+ * real time. setRealTime(false) stops this and the time only changes when advance() 
+ * or advanceToAlarm() is called, for repeatable tests.
+ *
+ * Long periods are simulated quickly: whole minutes, hours or days in which no 
+ * alarm can match are skipped in one step, so decades of simulated time take 
+ * seconds to run. The temperature registers are loaded if a skipped period 
+ * includes an automatic conversion.
+ */
+class MD_DS3231_BusSim : public MD_DS3231_BusMemory
+{
+  public:
+  /**
+   * Class Constructor
+   *
+   * The registers are set to the device power on values, with the oscillator 
+   * stopped flag (OSF) set.
+   *
+   * \param dev  the I2C address the simulated device answers to.
+   */
+  MD_DS3231_BusSim(uint8_t dev = DS3231_ID);
+
+  virtual uint8_t write(uint8_t dev, const uint8_t *buf, uint8_t len);
+  virtual uint8_t read(uint8_t dev, uint8_t *buf, uint8_t len);
+
+  /**
+   * Advance the simulated time
+   *
+   * Run the simulated device forward by the specified number of milliseconds,
+   * processing every second boundary that is crossed.
+   *
+   * \param ms  the number of milliseconds to advance.
+   */
+  void advance(uint32_t ms);
+
+  /**
+   * Advance the simulated time to the next alarm
+   *
+   * Run the simulated device forward to the start of the next second in which
+   * Alarm 1 or Alarm 2 matches, setting the alarm flag, or until the maximum 
+   * time has passed. 
+   *
+   * \param maxSecs  the maximum number of seconds to advance.
+   * \return the number of seconds advanced.
+   */
+  uint32_t advanceToAlarm(uint32_t maxSecs = 0xffffffffUL);
+
+  /**
+   * Set the simulated time multiplier
+   *
+   * When the simulation follows millis(), the simulated time advances by the
+   * elapsed time multiplied by this value.
+   *
+   * \param scale  the time multiplier, default 1.
+   */
+  inline void setTimeScale(uint16_t scale) { update(); _timeScale = scale; };
+
+  /**
+   * Set the time source for the simulation
+   *
+   * \param b  true (default) to follow millis(), false to only advance() the time.
+   */
+  void setRealTime(boolean b);
+
+  /**
+   * Get the INT/SQW pin level
+   *
+   * The pin is open drain and active low, so false means the interrupt is asserted.
+   *
+   * \return the logic level of the pin.
+   */
+  boolean intPin(void);
+
+  /**
+   * Set the temperature measured by the simulated device
+   *
+   * The value is loaded into the temperature registers at the end of the next 
+   * conversion.
+   *
+   * \param t  the temperature in units of 0.25 degrees C.
+   */
+  inline void setTemperature(int16_t t) { _temperature = t; };
+
+  /**
+   * Set the temperature conversion time
+   *
+   * \param ms  the time BSY is set for each conversion, default 125ms.
+   */
+  inline void setConversionTime(uint16_t ms) { _convTime = ms; };
+
+  /**
+   * Set the frequency error of the simulated crystal
+   *
+   * The simulated clock runs fast (positive) or slow (negative) by this amount.
+   * As on the device, each step of the aging offset register lowers the frequency
+   * by about 0.1ppm, taking effect at the end of the next temperature conversion.
+   * The error applies to the time passed to advance(), not to advanceToAlarm().
+   *
+   * \param ppb  the crystal error in parts per billion.
+   */
+  inline void setFrequencyError(int32_t ppb) { update(); _freqError = ppb; };
+
+  /**
+   * Get the frequency error of the simulated clock
+   *
+   * \return the crystal error corrected by the current aging offset, in parts per billion.
+   */
+  int32_t frequencyError(void);
+
+  protected:
+  virtual uint8_t readRegister(uint8_t addr);
+  virtual void writeRegister(uint8_t addr, uint8_t value);
+
+  /**
+   * Process the end of one second
+   *
+   * Increment the time registers and check the alarms. Derived classes 
+   * can override this to add behavior.
+   *
+   * \return true if an alarm matched the new time.
+   */
+  virtual boolean tickSecond(void);
+
+  private:
+  boolean _realTime;      // time follows millis()
+  uint16_t _timeScale;    // simulated milliseconds per millis()
+  uint32_t _lastMs;       // millis() at the last update
+  uint16_t _subMs;        // milliseconds into the current second
+  uint8_t _autoConv;      // seconds to the next automatic conversion
+  uint16_t _convTime;     // duration of a conversion
+  uint16_t _convMs;       // milliseconds left in the current conversion, 0 if none
+  int16_t _temperature;   // simulated temperature in 0.25C
+  int32_t _freqError;     // crystal error in ppb
+  int8_t _aging;          // aging offset in use by the TCXO
+  int64_t _driftAcc;      // accumulated drift in ms * ppb not yet applied
+
+  uint32_t driftMs(uint32_t ms);
+
+  void update(void);
+  uint32_t advanceSeconds(uint32_t secs, boolean toAlarm);
+  uint32_t secondsToSkip(void);
+  boolean alarmPossible(uint8_t level);
+  uint32_t timeOfDay(void);
+  void setTimeOfDay(uint32_t sod);
+  void incrementTime(void);
+  boolean checkAlarms(void);
+  void startConversion(void);
+  void endConversion(void);
+};
+
+#endif
@@ -0,0 +1,191 @@
+/*
+  MD_DS3231 - Library for using a DS3231 Real Time Clock.
+
+  Drift model and software time correction.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+ */
+#include "MD_DS3231_Drift.h"
+
+MD_DS3231_Drift::MD_DS3231_Drift(MD_DS3231 &rtc) : _rtc(rtc)
+{
+  driftModel_t m = { 0, 0, DRIFT_TURNOVER, 0 };
+
+  setModel(m);
+}
+
+void MD_DS3231_Drift::begin(void)
+{
+  _started = false;
+  _rtc.setCorrection(this);
+}
+
+void MD_DS3231_Drift::setModel(const driftModel_t &m)
+{
+  _model = m;
+  _started = false;
+  _quarters = m.turnover;
+  _lastSecs = m.syncSecs;
+  _predNs = 0;
+  _elapsed = 0;
+  _q = 0;
+  _nObs = 0;
+  _stt = _stq = _sqq = _sdt = _sdq = 0.0;
+}
+
+boolean MD_DS3231_Drift::service(void)
+{
+  uint32_t ms = millis();
+  uint32_t secs;
+  int16_t t;
+
+  if (_started && ms - _lastMs < DRIFT_PERIOD * 1000UL)
+    return(false);
+
+  if (!_rtc.readTemperature(t) || !_rtc.readRawSecs(secs))
+    return(false);
+
+  // the first sample after a restart also covers the time the power was off
+  if (!_started) _quarters = t;
+  integrate(secs);
+  _quarters = t;
+
+  _lastMs = ms;
+  _started = true;
+
+  return(true);
+}
+
+int64_t MD_DS3231_Drift::ratePpb(int16_t quarters)
+// Drift rate at the temperature. The coefficient is 0.001ppb per degree
+// squared and the temperature is in quarter degrees, hence the 16000.
+{
+  int32_t d = quarters - _model.turnover;
+
+  return(_model.rate + ((int64_t)_model.tempCoef * (d * d)) / 16000);
+}
+
+void MD_DS3231_Drift::integrate(uint32_t secs)
+// Bring the prediction up to the RTC time secs, using the last temperature read
+{
+  if (_model.syncSecs == 0)
+    return;
+
+  if ((int32_t)(secs - _lastSecs) <= 0)   // not moved on, or set back by someone else
+  {
+    _lastSecs = secs;
+    return;
+  }
+
+  uint32_t dt = secs - _lastSecs;
+  int32_t d = _quarters - _model.turnover;
+
+  _predNs += ratePpb(_quarters) * dt;
+  _q += (uint64_t)(d * d) * dt;
+  _elapsed += dt;
+  _lastSecs = secs;
+}
+
+int32_t MD_DS3231_Drift::predicted(void)
+{
+  return((int32_t)(_predNs / 1000000LL));
+}
+
+int32_t MD_DS3231_Drift::offsetMs(uint32_t rtcSecs)
+// Extend the prediction from the last integration to the time read, so the
+// correction does not depend on how often service() is called
+{
+  int64_t ns = _predNs;
+
+  if (_model.syncSecs == 0)
+    return(0);
+
+  if ((int32_t)(rtcSecs - _lastSecs) > 0)
+    ns += ratePpb(_quarters) * (rtcSecs - _lastSecs);
+
+  return((int32_t)(-ns / 1000000LL));
+}
+
+void MD_DS3231_Drift::timeWritten(uint32_t rtcSecs, uint32_t newSecs)
+// The RTC has been set. The drift since the last sync is the difference
+// between the RTC and the new time, if the RTC time is known.
+{
+  if (rtcSecs != DS3231_SECS_UNKNOWN)
+    integrate(rtcSecs);
+
+  if (rtcSecs != DS3231_SECS_UNKNOWN && _model.syncSecs != 0 && _elapsed >= DRIFT_MIN_INTERVAL)
+  {
+    int64_t driftNs = ((int64_t)rtcSecs - (int64_t)newSecs) * 1000000000LL;
+    int64_t limit = (int64_t)_elapsed * DRIFT_MAX_ERROR * 1000LL;
+
+    // a large difference is the time being changed, not drift
+    if (driftNs <= limit && driftNs >= -limit)
+      observe(driftNs);
+  }
+
+  // start the next interval, not synced if the time is beyond the seconds range
+  if (newSecs == DS3231_SECS_UNKNOWN)
+    _model.syncSecs = 0;
+  else
+    _model.syncSecs = (newSecs == 0) ? 1 : newSecs;
+  _lastSecs = newSecs;
+  _predNs = 0;
+  _elapsed = 0;
+  _q = 0;
+}
+
+void MD_DS3231_Drift::observe(int64_t driftNs)
+// Add the observation to the least squares sums and fit the model again
+{
+  float t = (float)_elapsed;
+  float q = (float)_q / 16.0;   // degrees C squared * seconds
+  float d = (float)driftNs;
+
+  if (_nObs >= DRIFT_MAX_OBS)   // let the model follow slow changes in the crystal
+  {
+    _stt /= 2; _stq /= 2; _sqq /= 2; _sdt /= 2; _sdq /= 2;
+    _nObs /= 2;
+  }
+
+  _stt += t * t;
+  _stq += t * q;
+  _sqq += q * q;
+  _sdt += d * t;
+  _sdq += d * q;
+  _nObs++;
+
+  fit();
+}
+
+void MD_DS3231_Drift::fit(void)
+// Solve d = rate * t + coef * q for both coefficients if the observations
+// cover different temperatures, otherwise for the rate using the current
+// temperature coefficient.
+{
+  float det = (_stt * _sqq) - (_stq * _stq);
+  float rate, coef = _model.tempCoef / 1000.0;
+
+  if (_stt <= 0)
+    return;
+
+  if (_nObs >= 2 && det > 0.01 * _stt * _sqq)
+  {
+    rate = ((_sdt * _sqq) - (_sdq * _stq)) / det;
+    coef = ((_stt * _sdq) - (_stq * _sdt)) / det;
+  }
+  else
+    rate = (_sdt - (coef * _stq)) / _stt;
+
+  const float MAX_PPB = DRIFT_MAX_ERROR * 1000.0;
+
+  if (rate > MAX_PPB) rate = MAX_PPB;
+  if (rate < -MAX_PPB) rate = -MAX_PPB;
+  if (coef > MAX_PPB) coef = MAX_PPB;
+  if (coef < -MAX_PPB) coef = -MAX_PPB;
+
+  _model.rate = (int32_t)(rate + ((rate < 0) ? -0.5 : 0.5));
+  _model.tempCoef = (int32_t)((coef * 1000.0) + ((coef < 0) ? -0.5 : 0.5));
+}
@@ -0,0 +1,160 @@
+#ifndef MD_DS3231_Drift_h
+#define MD_DS3231_Drift_h
+
+/**
+ * \file
+ * \brief Drift model and software time correction for the MD_DS3231 library
+ *
+ * Even with the aging offset trimmed, the DS3231 gains or loses a little time and
+ * the rate changes with temperature. The drift tracker learns this from the
+ * corrections the application makes when it sets the time from an accurate
+ * source, and corrects the times read between those syncs in software, without
+ * writing the device.
+ *
+ * The drift rate is modelled as the rate at the crystal turnover temperature plus
+ * a term proportional to the square of the distance from the turnover temperature.
+ * The temperature is read from the DS3231 every conversion period and the model is
+ * integrated over the elapsed time to predict how far the RTC is from the correct
+ * time. Each time the RTC is set through MD_DS3231::writeTime(), the difference
+ * between the RTC and the new time is the observed drift since the previous sync.
+ * The model coefficients are fitted to the observations by least squares.
+ *
+ * The RTC time before each sync is taken from the last time read, so the
+ * application should read the RTC shortly before setting it (see
+ * MD_DS3231_Correction::timeWritten()), otherwise the sync starts a new interval
+ * without an observation. The time written is only known to the nearest second,
+ * so the longer the time between syncs the more accurate each observation. Syncs
+ * less than DRIFT_MIN_INTERVAL apart are not used. The temperature coefficient can only be
+ * fitted once the observations cover different temperatures, until then the
+ * coefficient set with setModel() is used.
+ *
+ * The coefficients and the time of the last sync can be saved with getModel(),
+ * for example in EEPROM, and restored with setModel() at boot so the correction
+ * continues across restarts.
+ */
+
+#include "MD_DS3231.h"
+
+#define DRIFT_PERIOD        64    ///< Seconds between temperature samples
+#define DRIFT_TURNOVER      100   ///< Default turnover temperature in quarter degrees C (25C)
+#define DRIFT_MIN_INTERVAL  3600  ///< Shortest time between syncs used as an observation in seconds
+#define DRIFT_MAX_ERROR     500   ///< Largest drift used as an observation in ppm
+#define DRIFT_MAX_OBS       16    ///< Observations after which older observations are given half weight
+
+/**
+ * Drift model data structure.
+ *
+ * Holds the model coefficients and the time of the last sync, for the application
+ * to save and restore.
+ */
+struct driftModel_t
+{
+  int32_t rate;       ///< drift at the turnover temperature in ppb, positive if the RTC runs fast
+  int32_t tempCoef;   ///< change in drift per degree C squared from the turnover temperature, in 0.001 ppb
+  int16_t turnover;   ///< turnover temperature in quarter degrees C
+  uint32_t syncSecs;  ///< time of the last sync in seconds since 2000-01-01, 0 if not synced
+};
+
+/**
+ * Drift tracker.
+ *
+ * Once begin() is called the tracker is set as the MD_DS3231 software correction,
+ * so all the times read from the RTC are corrected by the predicted drift.
+ */
+class MD_DS3231_Drift : public MD_DS3231_Correction
+{
+  public:
+  /**
+   * Class Constructor
+   *
+   * The model starts with no drift and the default turnover temperature.
+   *
+   * \param rtc   the RTC object to correct.
+   */
+  MD_DS3231_Drift(MD_DS3231 &rtc);
+
+  /**
+   * Initialize the tracker
+   *
+   * Set the tracker as the software correction for the RTC. Call setModel()
+   * first to restore a saved model.
+   */
+  void begin(void);
+
+  /**
+   * Service the tracker
+   *
+   * Call this method from loop(). The RTC temperature is read every DRIFT_PERIOD
+   * seconds and the predicted drift brought up to date, otherwise the RTC is not
+   * accessed.
+   *
+   * \return true if the temperature was read, false otherwise.
+   */
+  boolean service(void);
+
+  /**
+   * Get the model
+   *
+   * \param m the structure to receive the model coefficients and last sync time.
+   */
+  inline void getModel(driftModel_t &m) { m = _model; };
+
+  /**
+   * Set the model
+   *
+   * Replace the model, for example with one saved before a restart. The prediction
+   * restarts from the sync time in the model and any observations are discarded.
+   *
+   * \param m the model coefficients and last sync time.
+   */
+  void setModel(const driftModel_t &m);
+
+  /**
+   * Get the predicted drift
+   *
+   * \return the milliseconds the RTC is predicted to be ahead of the correct time.
+   */
+  int32_t predicted(void);
+
+  /**
+   * Get the number of observations in the fit
+   *
+   * \return the number of observations, including those given half weight.
+   */
+  inline uint8_t observations(void) { return(_nObs); };
+
+  /**
+   * Correction callback, see MD_DS3231_Correction::offsetMs()
+   */
+  virtual int32_t offsetMs(uint32_t rtcSecs);
+
+  /**
+   * Correction callback, see MD_DS3231_Correction::timeWritten()
+   */
+  virtual void timeWritten(uint32_t rtcSecs, uint32_t newSecs);
+
+  private:
+  MD_DS3231 &_rtc;          // the RTC we are correcting
+  driftModel_t _model;      // current model
+  boolean _started;         // the first temperature sample has been taken
+  uint32_t _lastMs;         // millis() at the last temperature sample
+  int16_t _quarters;        // last temperature read
+  uint32_t _lastSecs;       // RTC time the prediction has been integrated to
+
+  // integrated since the last sync
+  int64_t _predNs;          // predicted drift in ns
+  uint32_t _elapsed;        // seconds
+  uint64_t _q;              // (temperature - turnover)^2 in quarter degrees squared * seconds
+
+  // least squares sums. t is elapsed seconds, q is the temperature integral in
+  // degrees C squared * seconds and d is the observed drift in ns.
+  uint8_t _nObs;
+  float _stt, _stq, _sqq, _sdt, _sdq;
+
+  int64_t ratePpb(int16_t quarters);
+  void integrate(uint32_t secs);
+  void observe(int64_t driftNs);
+  void fit(void);
+};
+
+#endif
@@ -0,0 +1,198 @@
+/*
+  MD_DS3231 - Library for using a DS3231 Real Time Clock.
+
+  Software alarm scheduler.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+ */
+#include "MD_DS3231_Scheduler.h"
+
+MD_DS3231_Scheduler::MD_DS3231_Scheduler(MD_DS3231 &rtc, schedEvent_t *store, uint8_t size) :
+_rtc(rtc), _heap(store), _size(size), _count(0), _nextId(1), _armed(0), _due(false), _run(0)
+{
+}
+
+boolean MD_DS3231_Scheduler::begin(void)
+{
+  _rtc.setAlarm1Callback(alarmCallback, this);
+
+  _rtc.beginControl();
+  _rtc.control(DS3231_INT_ENABLE, DS3231_ON);
+  _rtc.control(DS3231_A1_INT_ENABLE, DS3231_ON);
+  if (!_rtc.commitControl())
+    return(false);
+
+  _armed = 0;     // force the alarm to be programmed
+  _due = arm();
+
+  return(true);
+}
+
+uint8_t MD_DS3231_Scheduler::add(uint32_t when, void (*cb)(void *), void *ctx)
+{
+  return(addRecurring(when, 0, cb, ctx));
+}
+
+uint8_t MD_DS3231_Scheduler::addRecurring(uint32_t first, uint32_t period, void (*cb)(void *), void *ctx)
+{
+  uint8_t i, id;
+
+  if (_count >= _size || cb == nullptr)
+    return(0);
+
+  // find an identifier that is not in use
+  do
+  {
+    if (_nextId == 0) _nextId = 1;
+    for (i = 0; i < _count; i++)
+      if (_heap[i].id == _nextId)
+        break;
+    if (i < _count) _nextId++;
+  } while (i < _count);
+  id = _nextId++;
+
+  i = _count++;
+  _heap[i].next = first;
+  _heap[i].period = period;
+  _heap[i].cb = cb;
+  _heap[i].ctx = ctx;
+  _heap[i].id = id;
+  siftUp(i);
+
+  if (arm()) _due = true;
+
+  return(id);
+}
+
+boolean MD_DS3231_Scheduler::remove(uint8_t id)
+{
+  for (uint8_t i = 0; i < _count; i++)
+  {
+    if (_heap[i].id == id)
+    {
+      removeAt(i);
+      if (arm()) _due = true;
+      return(true);
+    }
+  }
+
+  return(false);
+}
+
+uint8_t MD_DS3231_Scheduler::service(void)
+{
+  _run = 0;
+
+  _rtc.serviceAlarms();   // runs dispatch() through the Alarm 1 callback
+  if (_due)
+    dispatch();
+
+  return(_run);
+}
+
+void MD_DS3231_Scheduler::alarmCallback(void *ctx)
+{
+  static_cast<MD_DS3231_Scheduler *>(ctx)->dispatch();
+}
+
+void MD_DS3231_Scheduler::dispatch(void)
+// Run all the events that are due, re-arm the alarm and repeat if the
+// next event became due while we were busy.
+{
+  uint32_t now;
+
+  _due = false;
+  do
+  {
+    if (!_rtc.readRawSecs(now))
+      return;
+
+    while (_count != 0 && _heap[0].next <= now)
+    {
+      schedEvent_t e = _heap[0];  // copy, the callback may change the heap
+
+      if (e.period == 0)
+        removeAt(0);
+      else
+      {
+        _heap[0].next += ((now - e.next) / e.period + 1) * e.period;
+        siftDown(0);
+      }
+
+      e.cb(e.ctx);
+      _run++;
+    }
+    _armed = 0;   // the alarm has been used, always program the next one
+  } while (arm());
+}
+
+boolean MD_DS3231_Scheduler::arm(void)
+// Program the earliest event into Alarm 1 if it has changed.
+// Return true if the event is already due, as the alarm may not fire.
+{
+  uint32_t now;
+
+  if (_count == 0 || _heap[0].next == _armed)
+    return(false);
+
+  if (!_rtc.writeAlarm1Secs(_heap[0].next))
+    return(false);
+  _armed = _heap[0].next;
+
+  if (!_rtc.readRawSecs(now))
+    return(false);
+
+  return(_armed <= now);
+}
+
+void MD_DS3231_Scheduler::swap(uint8_t i, uint8_t j)
+{
+  schedEvent_t t = _heap[i];
+
+  _heap[i] = _heap[j];
+  _heap[j] = t;
+}
+
+void MD_DS3231_Scheduler::siftUp(uint8_t i)
+{
+  while (i > 0)
+  {
+    uint8_t p = (i - 1) / 2;
+
+    if (_heap[p].next <= _heap[i].next)
+      break;
+    swap(i, p);
+    i = p;
+  }
+}
+
+void MD_DS3231_Scheduler::siftDown(uint8_t i)
+{
+  for (;;)
+  {
+    uint16_t l = 2 * i + 1;
+    uint16_t r = l + 1;
+    uint8_t m = i;
+
+    if (l < _count && _heap[l].next < _heap[m].next) m = l;
+    if (r < _count && _heap[r].next < _heap[m].next) m = r;
+    if (m == i)
+      break;
+    swap(i, m);
+    i = m;
+  }
+}
+
+void MD_DS3231_Scheduler::removeAt(uint8_t i)
+// Replace the element with the last one and restore the heap order
+{
+  if (--_count == i)
+    return;
+
+  _heap[i] = _heap[_count];
+  siftDown(i);
+  siftUp(i);
+}
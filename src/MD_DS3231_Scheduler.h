@@ -0,0 +1,156 @@
+#ifndef MD_DS3231_Scheduler_h
+#define MD_DS3231_Scheduler_h
+
+/**
+ * \file
+ * \brief Software alarm scheduler for the MD_DS3231 library
+ *
+ * The DS3231 only has two hardware alarms. The scheduler keeps any number of
+ * one-shot and recurring events in a min-heap ordered by the next time each
+ * event is due, and always programs the earliest event into Alarm 1. When the
+ * alarm fires, all the events that are due are run and Alarm 1 is re-armed for
+ * the next one, so the processor can sleep between events instead of polling
+ * and comparing times in software.
+ *
+ * Event times are specified as the number of seconds since 2000-01-01 00:00:00,
+ * as returned by MD_DS3231::time2Secs() and MD_DS3231::readRawSecs(). Alarm 1
+ * matches the RTC registers, so event times are in the uncorrected RTC time and
+ * are not moved by a software correction set with MD_DS3231::setCorrection().
+ */
+
+#include "MD_DS3231.h"
+
+/**
+ * Scheduled event data structure.
+ *
+ * The application supplies an array of these to the scheduler for storage.
+ * The contents are managed by the scheduler and should not be changed directly.
+ */
+struct schedEvent_t
+{
+  uint32_t next;          ///< next time the event is due, in seconds since 2000-01-01
+  uint32_t period;        ///< repeat period in seconds, 0 for a one-shot event
+  void (*cb)(void *);     ///< the event callback function
+  void *ctx;              ///< user context pointer passed to the callback
+  uint8_t id;             ///< event identifier returned when the event was added
+};
+
+/**
+ * Software alarm scheduler using RTC Alarm 1.
+ *
+ * The scheduler takes over Alarm 1 and the Alarm 1 callback of the MD_DS3231
+ * object. Alarm 2 remains available to the application. service() must be
+ * called from loop(); it calls MD_DS3231::serviceAlarms() so Alarm 2 callbacks
+ * and the interrupt mode set with setAlarmInterruptMode() work as normal.
+ */
+class MD_DS3231_Scheduler
+{
+  public:
+  /**
+   * Class Constructor
+   *
+   * \param rtc   the RTC object used for the hardware alarm.
+   * \param store application supplied storage for the event heap.
+   * \param size  the number of elements in _store_.
+   */
+  MD_DS3231_Scheduler(MD_DS3231 &rtc, schedEvent_t *store, uint8_t size);
+
+  /**
+   * Initialize the scheduler
+   *
+   * Register the scheduler as the Alarm 1 callback and enable the Alarm 1
+   * interrupt on the INT/SQW pin. Events may be added before or after this
+   * method is invoked.
+   *
+   * \return false if errors, true otherwise.
+   */
+  boolean begin(void);
+
+  /**
+   * Add a one-shot event
+   *
+   * The callback is invoked once at or after the specified time and the event
+   * is then removed. An event that is already due runs on the next call to service().
+   *
+   * \sa addRecurring() method, remove() method
+   *
+   * \param when  the time the event is due, in seconds since 2000-01-01.
+   * \param cb    the callback function, prototype void functionName(void *ctx).
+   * \param ctx   the user context pointer passed to the callback.
+   * \return the event identifier or 0 if there is no space left.
+   */
+  uint8_t add(uint32_t when, void (*cb)(void *), void *ctx = nullptr);
+
+  /**
+   * Add a recurring event
+   *
+   * The callback is invoked at _first_ and then every _period_ seconds until
+   * the event is removed. If more than one period is missed (eg, the alarm
+   * was not serviced) the callback is invoked once and the event is moved to
+   * its next future time.
+   *
+   * \sa add() method, remove() method
+   *
+   * \param first   the first time the event is due, in seconds since 2000-01-01.
+   * \param period  the repeat period in seconds, 0 for a one-shot event.
+   * \param cb      the callback function, prototype void functionName(void *ctx).
+   * \param ctx     the user context pointer passed to the callback.
+   * \return the event identifier or 0 if there is no space left.
+   */
+  uint8_t addRecurring(uint32_t first, uint32_t period, void (*cb)(void *), void *ctx = nullptr);
+
+  /**
+   * Remove an event
+   *
+   * Remove the event from the scheduler. Events may be removed from inside
+   * an event callback, including the event being run.
+   *
+   * \param id  the event identifier returned by add() or addRecurring().
+   * \return false if the event was not found, true otherwise.
+   */
+  boolean remove(uint8_t id);
+
+  /**
+   * Get the number of events scheduled
+   *
+   * \return the number of events.
+   */
+  inline uint8_t count(void) { return(_count); };
+
+  /**
+   * Get the time of the next event
+   *
+   * \return the time the earliest event is due in seconds since 2000-01-01, 0 if none.
+   */
+  inline uint32_t nextEvent(void) { return(_count ? _heap[0].next : 0); };
+
+  /**
+   * Service the scheduler
+   *
+   * Call this method from loop(). It services the RTC alarms and runs the
+   * callbacks for all the events that are due.
+   *
+   * \return the number of events run.
+   */
+  uint8_t service(void);
+
+  private:
+  MD_DS3231 &_rtc;        // the RTC we are using
+  schedEvent_t *_heap;    // event storage, organised as a min-heap on next
+  uint8_t _size;          // number of elements in _heap
+  uint8_t _count;         // number of events in _heap
+  uint8_t _nextId;        // next event identifier to try
+  uint32_t _armed;        // the time programmed into Alarm 1, 0 if not armed
+  boolean _due;           // events are due without an alarm being detected
+  uint8_t _run;           // events run by the current dispatch
+
+  static void alarmCallback(void *ctx);
+  void dispatch(void);
+  boolean arm(void);
+  void swap(uint8_t i, uint8_t j);
+  void siftUp(uint8_t i);
+  void siftDown(uint8_t i);
+  void removeAt(uint8_t i);
+};
+
+#endif
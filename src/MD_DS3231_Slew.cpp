@@ -0,0 +1,218 @@
+/*
+  MD_DS3231 - Library for using a DS3231 Real Time Clock.
+
+  Clock slewing.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+ */
+#include "MD_DS3231_Slew.h"
+
+MD_DS3231_Slew::MD_DS3231_Slew(MD_DS3231 &rtc) :
+_rtc(rtc), _next(nullptr), _stepPpb(SLEW_STEP_PPB), _startSecs(0),
+_agingActive(false), _agingCancel(false), _baseAging(0), _agingEnd(0),
+_swActive(false), _swFrom(0), _swTo(0), _swPeriod(0),
+_visValid(false), _lastVis(0), _lastRaw(0), _checkMs(0)
+{
+}
+
+void MD_DS3231_Slew::begin(MD_DS3231_Correction *next)
+{
+  _next = next;
+  _visValid = false;
+  _rtc.setCorrection(this);
+}
+
+boolean MD_DS3231_Slew::start(int32_t offsetMs, uint32_t period, slewMode_t mode)
+{
+  int64_t absMs64 = (offsetMs < 0) ? -(int64_t)offsetMs : offsetMs;
+  uint32_t absMs, agingMs = 0;
+  uint8_t v;
+
+  // no faster than SLEW_MAX_PPM, which also keeps the magnitude within int32_t
+  if (period == 0 || absMs64 > ((int64_t)period * SLEW_MAX_PPM) / 1000)
+    return(false);
+  absMs = (uint32_t)absMs64;
+
+  if (!stop())
+    return(false);
+  if (offsetMs == 0)
+    return(true);
+  if (!_rtc.readRawSecs(_startSecs))
+    return(false);
+
+  if (mode != SLEW_SOFTWARE)
+  {
+    if (_rtc.readRAM(DS3231_AGING_REG, &v, 1) != 1)
+      return(false);
+    _baseAging = (int8_t)v;
+
+    // steps needed to make the correction within the period. A positive
+    // offset slows the oscillator, so moving the time forward needs a
+    // negative offset.
+    uint64_t needPpb = ((uint64_t)absMs * 1000000ULL) / period;
+    int32_t steps = (int32_t)((needPpb + _stepPpb - 1) / _stepPpb);
+    int32_t room = (offsetMs > 0) ? (_baseAging + 128) : (127 - _baseAging);
+
+    if (steps > room) steps = room;
+    if (steps == 0 && mode == SLEW_AGING)
+      return(false);
+
+    if (steps != 0)
+    {
+      uint32_t rate = steps * _stepPpb;
+      uint32_t dur = (uint32_t)(((uint64_t)absMs * 1000000ULL + rate - 1) / rate);
+
+      agingMs = absMs;
+      if (mode == SLEW_BOTH && dur > period)
+      {
+        dur = period;
+        agingMs = (uint32_t)(((uint64_t)rate * period) / 1000000ULL);
+      }
+
+      int16_t aging = _baseAging + ((offsetMs > 0) ? -steps : steps);
+
+      if (!_rtc.control(DS3231_AGING_OFFSET, (uint8_t)aging))
+        return(false);
+      _rtc.startConversion();   // apply the bias now instead of at the next conversion
+      _agingActive = true;
+      _agingEnd = _startSecs + dur;
+    }
+  }
+
+  if (mode != SLEW_AGING && agingMs < absMs)
+  {
+    // the rest in software
+    int32_t swMs = absMs - agingMs;
+
+    _swTo = _swFrom + ((offsetMs > 0) ? swMs : -swMs);
+    _swPeriod = period;
+    _swActive = true;
+  }
+
+  _checkMs = millis();
+
+  return(true);
+}
+
+boolean MD_DS3231_Slew::restoreAging(void)
+{
+  if (!_rtc.control(DS3231_AGING_OFFSET, (uint8_t)_baseAging))
+    return(false);
+  _rtc.startConversion();
+  _agingActive = _agingCancel = false;
+
+  return(true);
+}
+
+boolean MD_DS3231_Slew::stop(void)
+{
+  if (_swActive)
+  {
+    uint32_t secs;
+
+    if (!_rtc.readRawSecs(secs))
+      return(false);
+    _swFrom = _swTo = softOffset(secs);
+    _swActive = false;
+  }
+
+  if (_agingActive)
+    return(restoreAging());
+
+  return(true);
+}
+
+boolean MD_DS3231_Slew::service(void)
+{
+  uint32_t secs;
+
+  if (_agingCancel)
+    return(restoreAging());
+
+  if (!active() || millis() - _checkMs < SLEW_CHECK_MS)
+    return(false);
+
+  if (!_rtc.readRawSecs(secs))
+    return(false);
+  _checkMs = millis();
+
+  if (_agingActive && (int32_t)(secs - _agingEnd) >= 0)
+    restoreAging();
+
+  if (_swActive && secs - _startSecs >= _swPeriod)
+  {
+    _swFrom = _swTo;
+    _swActive = false;
+  }
+
+  return(!active());
+}
+
+int32_t MD_DS3231_Slew::softOffset(uint32_t rtcSecs)
+// Software correction at the RTC time, growing linearly over the slew
+{
+  if (!_swActive)
+    return(_swFrom);
+
+  uint32_t el = rtcSecs - _startSecs;
+
+  if ((int32_t)el < 0) el = 0;
+  if (el >= _swPeriod)
+    return(_swTo);
+
+  return(_swFrom + (int32_t)(((int64_t)(_swTo - _swFrom) * el) / _swPeriod));
+}
+
+int32_t MD_DS3231_Slew::offsetMs(uint32_t rtcSecs)
+// The library rounds the correction to whole seconds, which could make the
+// seconds go back by one as the correction falls, so hold the last seconds
+// returned until the RTC catches up. As the correction rises the rounding
+// could also step the seconds on by two as the RTC ticks, so hold the extra
+// second until the next read.
+{
+  int32_t off = softOffset(rtcSecs);
+
+  if (_next != nullptr)
+    off += _next->offsetMs(rtcSecs);
+
+  uint32_t vis = rtcSecs + ((off + ((off < 0) ? -500 : 500)) / 1000);
+
+  if (_visValid)
+  {
+    uint32_t hold = vis;
+    uint32_t ticks = rtcSecs - _lastRaw;
+
+    if ((int32_t)(vis - _lastVis) < 0)
+      hold = _lastVis;
+    else if ((int32_t)ticks >= 0 && vis - _lastVis > ((ticks == 0) ? 1 : ticks))
+      hold = _lastVis + ((ticks == 0) ? 1 : ticks);
+
+    if (hold != vis)
+    {
+      off = (int32_t)(hold - rtcSecs) * 1000;
+      vis = hold;
+    }
+  }
+  _lastVis = vis;
+  _lastRaw = rtcSecs;
+  _visValid = true;
+
+  return(off);
+}
+
+void MD_DS3231_Slew::timeWritten(uint32_t rtcSecs, uint32_t newSecs)
+// The time has been set, so it is taken as correct. The aging offset is
+// restored by the next service() rather than from inside the library's write.
+{
+  if (_next != nullptr)
+    _next->timeWritten(rtcSecs, newSecs);
+
+  _swFrom = _swTo = 0;
+  _swActive = false;
+  _visValid = false;
+  if (_agingActive)
+    _agingCancel = true;
+}
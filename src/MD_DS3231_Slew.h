@@ -0,0 +1,185 @@
+#ifndef MD_DS3231_Slew_h
+#define MD_DS3231_Slew_h
+
+/**
+ * \file
+ * \brief Clock slewing for the MD_DS3231 library
+ *
+ * Correcting the time with MD_DS3231::writeTime() makes the clock jump, which
+ * upsets interval measurements and can skip or repeat alarms. The slew object
+ * instead spreads a correction over a period of time, in the same way as the
+ * adjtime() system call:
+ * - __Aging__ slewing biases the aging offset register so the oscillator runs
+ * fast or slow until the correction has been made, then restores the register.
+ * The RTC time itself moves smoothly, so alarms still match exactly once. The
+ * aging offset changes the frequency by about 0.1ppm per step, so at most about
+ * 12ppm or 1 second in 22 hours is possible.
+ * - __Software__ slewing adds a correction that grows steadily over the period
+ * to the times read from the RTC (see MD_DS3231::setCorrection()). The RTC is not
+ * changed, so alarms match on the uncorrected RTC time. The correction stays in
+ * place when the slew is finished, until the time is next written.
+ * - __Both__ uses the aging offset as far as it can within the period and software
+ * slewing for the rest.
+ *
+ * Slews faster than SLEW_MAX_PPM are not started, so the time read never stops or
+ * runs backwards. The seconds returned by the library are also held so they never
+ * go backwards, or on by two at once, when the correction is rounded.
+ *
+ * Another correction, for example an MD_DS3231_Drift object, can be chained so both
+ * are applied. The aging offset should not be changed by anything else, for example
+ * an MD_DS3231_AgingCal object, while an aging slew is in progress. If the processor
+ * restarts during an aging slew the bias stays in the register, so applications
+ * that need to recover should save baseAging() and restore it at boot.
+ */
+
+#include "MD_DS3231.h"
+
+#define SLEW_MAX_PPM    500   ///< Fastest slew in parts per million
+#define SLEW_STEP_PPB   100   ///< Default frequency change per aging offset step in parts per billion
+#define SLEW_CHECK_MS   1000  ///< Milliseconds between checks of the RTC by service()
+
+/**
+ * Slewing method for MD_DS3231_Slew::start().
+ */
+enum slewMode_t
+{
+  SLEW_AGING,     ///< Bias the aging offset register only
+  SLEW_SOFTWARE,  ///< Correct the time read in software only
+  SLEW_BOTH,      ///< Bias the aging offset as far as possible and correct the rest in software
+};
+
+/**
+ * Clock slewing.
+ *
+ * Once begin() is called the object is set as the MD_DS3231 software correction.
+ */
+class MD_DS3231_Slew : public MD_DS3231_Correction
+{
+  public:
+  /**
+   * Class Constructor
+   *
+   * \param rtc   the RTC object to slew.
+   */
+  MD_DS3231_Slew(MD_DS3231 &rtc);
+
+  /**
+   * Initialize the slewing
+   *
+   * Set this object as the software correction for the RTC, applying the
+   * _next_ correction, if any, as well.
+   *
+   * \param next  another correction to apply as well, nullptr if none.
+   */
+  void begin(MD_DS3231_Correction *next = nullptr);
+
+  /**
+   * Start slewing the time
+   *
+   * Start correcting the time by _offsetMs_ over _period_ seconds. Any slew in
+   * progress is stopped first. With SLEW_AGING the period is extended if the aging
+   * offset cannot make the correction in time. A correction of more than SLEW_MAX_PPM
+   * of the period is rejected in every mode.
+   *
+   * \param offsetMs  the correction in milliseconds, positive to move the time forward.
+   * \param period    the seconds to spread the correction over.
+   * \param mode      one of the slewMode_t values.
+   * \return false if errors or the correction cannot be made, true otherwise.
+   */
+  boolean start(int32_t offsetMs, uint32_t period, slewMode_t mode = SLEW_BOTH);
+
+  /**
+   * Stop slewing the time
+   *
+   * Restore the aging offset register and keep the software correction
+   * reached so far.
+   *
+   * \return false if errors, true otherwise.
+   */
+  boolean stop(void);
+
+  /**
+   * Service the slewing
+   *
+   * Call this method from loop(). While a slew is in progress the RTC time is
+   * read every SLEW_CHECK_MS to find when it is finished, otherwise the RTC
+   * is not accessed.
+   *
+   * \return true if the slew finished, false otherwise.
+   */
+  boolean service(void);
+
+  /**
+   * Check if a slew is in progress
+   *
+   * \return true if slewing, false otherwise.
+   */
+  inline boolean active(void) { return(_agingActive || _swActive); };
+
+  /**
+   * Get the software correction
+   *
+   * \return the standing software correction in milliseconds, not including a slew in progress.
+   */
+  inline int32_t offset(void) { return(_swFrom); };
+
+  /**
+   * Set the software correction
+   *
+   * Replace the standing software correction, for example to restore it at boot.
+   * Any software slew in progress is stopped.
+   *
+   * \param ms  the correction in milliseconds.
+   */
+  inline void setOffset(int32_t ms) { _swFrom = _swTo = ms; _swActive = false; _visValid = false; };
+
+  /**
+   * Get the aging offset before the slew
+   *
+   * \return the aging offset register value that is restored when the slew finishes.
+   */
+  inline int8_t baseAging(void) { return(_baseAging); };
+
+  /**
+   * Set the aging offset sensitivity
+   *
+   * \param ppb  the frequency change per aging offset step in parts per billion.
+   */
+  inline void setStep(uint16_t ppb) { if (ppb != 0) _stepPpb = ppb; };
+
+  /**
+   * Correction callback, see MD_DS3231_Correction::offsetMs()
+   */
+  virtual int32_t offsetMs(uint32_t rtcSecs);
+
+  /**
+   * Correction callback, see MD_DS3231_Correction::timeWritten()
+   */
+  virtual void timeWritten(uint32_t rtcSecs, uint32_t newSecs);
+
+  private:
+  MD_DS3231 &_rtc;              // the RTC we are slewing
+  MD_DS3231_Correction *_next;  // chained correction
+  uint16_t _stepPpb;            // ppb per aging step
+  uint32_t _startSecs;          // RTC time the slew started
+
+  boolean _agingActive;         // aging offset is biased
+  boolean _agingCancel;         // restore the aging offset at the next service()
+  int8_t _baseAging;            // aging offset to restore
+  uint32_t _agingEnd;           // RTC time to restore the aging offset
+
+  boolean _swActive;            // software slew in progress
+  int32_t _swFrom, _swTo;       // software correction at the start and end of the slew
+  uint32_t _swPeriod;           // seconds for the software slew
+
+  boolean _visValid;            // _lastVis is set
+  uint32_t _lastVis;            // last corrected seconds returned
+  uint32_t _lastRaw;            // RTC seconds when _lastVis was returned
+
+  uint32_t _checkMs;            // millis() at the last check in service()
+
+  int32_t softOffset(uint32_t rtcSecs);
+  boolean restoreAging(void);
+};
+
+#endif
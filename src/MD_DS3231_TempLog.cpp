@@ -0,0 +1,183 @@
+/*
+  MD_DS3231 - Library for using a DS3231 Real Time Clock.
+
+  Temperature history logger.
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+ */
+#include "MD_DS3231_TempLog.h"
+
+MD_DS3231_TempLog::MD_DS3231_TempLog(MD_DS3231 &rtc, tempSample_t *store, uint16_t size) :
+_rtc(rtc), _store(store), _size(size), _intervalMs(TEMPLOG_PERIOD * 1000UL)
+{
+  clear();
+}
+
+void MD_DS3231_TempLog::begin(uint8_t interval)
+{
+  if (interval == 0) interval = 1;
+  _intervalMs = interval * (TEMPLOG_PERIOD * 1000UL);
+  clear();
+}
+
+void MD_DS3231_TempLog::clear(void)
+{
+  _head = _count = 0;
+  _started = false;
+  _lastMs = 0;
+  _min = _max = 0;
+  _sum = 0;
+  _sumSq = 0;
+}
+
+boolean MD_DS3231_TempLog::service(void)
+{
+  uint32_t ms = millis();
+
+  if (_started && ms - _lastMs < _intervalMs)
+    return(false);
+
+  if (!sample())
+    return(false);
+
+  // keep to the interval even if service() was called late
+  if (_started)
+    _lastMs += ((ms - _lastMs) / _intervalMs) * _intervalMs;
+  else
+    _lastMs = ms;
+  _started = true;
+
+  return(true);
+}
+
+boolean MD_DS3231_TempLog::sample(void)
+{
+  uint32_t secs;
+  int16_t t;
+
+  if (!_rtc.readTemperature(t) || !_rtc.readSecs(secs))
+    return(false);
+
+  add(secs, t);
+
+  return(true);
+}
+
+void MD_DS3231_TempLog::add(uint32_t secs, int16_t quarters)
+// Add the sample, replacing the oldest one if the buffer is full, and
+// keep the sums and extremes up to date
+{
+  boolean rescanNeeded = false;
+  uint16_t i;
+
+  if (_size == 0)
+    return;
+
+  if (_count == _size)    // full - remove the oldest sample from the statistics
+  {
+    int16_t old = _store[_head].quarters;
+
+    _sum -= old;
+    _sumSq -= (uint32_t)((int32_t)old * old);
+    rescanNeeded = (old == _min || old == _max);
+
+    i = _head;
+    if (++_head == _size) _head = 0;
+  }
+  else
+  {
+    i = _head + _count;
+    if (i >= _size) i -= _size;
+    _count++;
+  }
+
+  _store[i].secs = secs;
+  _store[i].quarters = quarters;
+  _sum += quarters;
+  _sumSq += (uint32_t)((int32_t)quarters * quarters);
+
+  if (rescanNeeded)
+    rescan();     // the extreme has left the buffer, only now is a search needed
+  else if (_count == 1)
+    _min = _max = quarters;
+  else
+  {
+    if (quarters < _min) _min = quarters;
+    if (quarters > _max) _max = quarters;
+  }
+}
+
+void MD_DS3231_TempLog::rescan(void)
+// Find the extremes of all the samples in the buffer
+{
+  uint16_t i = _head;
+
+  _min = _max = _store[i].quarters;
+  for (uint16_t n = 1; n < _count; n++)
+  {
+    if (++i == _size) i = 0;
+    if (_store[i].quarters < _min) _min = _store[i].quarters;
+    if (_store[i].quarters > _max) _max = _store[i].quarters;
+  }
+}
+
+boolean MD_DS3231_TempLog::get(uint16_t i, tempSample_t &s)
+{
+  if (i >= _count)
+    return(false);
+
+  i += _head;
+  if (i >= _size) i -= _size;
+  s = _store[i];
+
+  return(true);
+}
+
+int16_t MD_DS3231_TempLog::mean(void)
+// Rounded to nearest, halves away from zero
+{
+  if (_count == 0)
+    return(0);
+
+  if (_sum >= 0)
+    return((_sum + _count / 2) / _count);
+  else
+    return(-((-_sum + _count / 2) / _count));
+}
+
+uint32_t MD_DS3231_TempLog::variance(void)
+// (n * sum(x^2) - sum(x)^2) / n^2, exact in 64 bit integers
+{
+  if (_count == 0)
+    return(0);
+
+  uint64_t n2 = (uint64_t)_count * _count;
+  uint64_t v = (uint64_t)_count * _sumSq - (uint64_t)((int64_t)_sum * _sum);
+
+  return((uint32_t)((v + n2 / 2) / n2));
+}
+
+uint16_t MD_DS3231_TempLog::exportRecords(uint8_t *buf, uint16_t size, uint16_t first)
+{
+  uint16_t n = 0;
+  tempSample_t s;
+
+  while (size >= TEMPLOG_RECORD_SIZE && get(first + n, s))
+  {
+    buf[0] = s.secs & 0xff;
+    buf[1] = (s.secs >> 8) & 0xff;
+    buf[2] = (s.secs >> 16) & 0xff;
+    buf[3] = (s.secs >> 24) & 0xff;
+    buf[4] = (uint16_t)s.quarters & 0xff;
+    buf[5] = ((uint16_t)s.quarters >> 8) & 0xff;
+
+    buf += TEMPLOG_RECORD_SIZE;
+    size -= TEMPLOG_RECORD_SIZE;
+    n++;
+  }
+
+  return(n);
+}
@@ -0,0 +1,183 @@
+#ifndef MD_DS3231_TempLog_h
+#define MD_DS3231_TempLog_h
+
+/**
+ * \file
+ * \brief Temperature history logger for the MD_DS3231 library
+ *
+ * The DS3231 measures its own temperature every 64 seconds to run the TCXO. The
+ * logger keeps a history of these readings in a fixed size ring buffer supplied
+ * by the application, so no memory is allocated. Samples are taken on a multiple
+ * of the 64 second conversion period, as reading the temperature more often only
+ * returns the same value.
+ *
+ * The minimum, maximum, mean and variance of the samples in the buffer are kept
+ * up to date as each sample is added, using integer arithmetic only. The history
+ * can be exported as packed records for logging or transmission.
+ *
+ * Temperatures are in quarter degrees C (see MD_DS3231::readTemperature()) and
+ * sample times are the number of seconds since 2000-01-01 00:00:00, as returned
+ * by MD_DS3231::readSecs().
+ */
+
+#include "MD_DS3231.h"
+
+#define TEMPLOG_PERIOD      64  ///< Seconds between DS3231 automatic temperature conversions
+#define TEMPLOG_RECORD_SIZE 6   ///< Bytes in each exported record
+
+/**
+ * Temperature sample data structure.
+ *
+ * The application supplies an array of these to the logger for storage.
+ * The contents are managed by the logger and should not be changed directly.
+ */
+struct tempSample_t
+{
+  uint32_t secs;      ///< time of the sample in seconds since 2000-01-01
+  int16_t quarters;   ///< temperature in quarter degrees C
+};
+
+/**
+ * Temperature history logger.
+ *
+ * Samples the RTC temperature register every _interval_ conversion periods into
+ * a ring buffer. When the buffer is full the oldest sample is replaced.
+ */
+class MD_DS3231_TempLog
+{
+  public:
+  /**
+   * Class Constructor
+   *
+   * \param rtc   the RTC object to read the temperature from.
+   * \param store application supplied storage for the samples.
+   * \param size  the number of elements in _store_.
+   */
+  MD_DS3231_TempLog(MD_DS3231 &rtc, tempSample_t *store, uint16_t size);
+
+  /**
+   * Initialize the logger
+   *
+   * Clear the history and set the sampling interval. The first sample
+   * is taken on the next call to service().
+   *
+   * \param interval  the number of TEMPLOG_PERIOD conversion periods between samples.
+   */
+  void begin(uint8_t interval = 1);
+
+  /**
+   * Clear the history
+   *
+   * Remove all the samples and reset the statistics.
+   */
+  void clear(void);
+
+  /**
+   * Service the logger
+   *
+   * Call this method from loop(). A sample is read from the RTC when the sampling
+   * interval has elapsed, otherwise the RTC is not accessed.
+   *
+   * \return true if a sample was added, false otherwise.
+   */
+  boolean service(void);
+
+  /**
+   * Take a sample now
+   *
+   * Read the time and temperature from the RTC and add them to the history.
+   * Use this to take samples on the application's own schedule (eg, from a
+   * MD_DS3231_Scheduler event) instead of calling service().
+   *
+   * \return false if errors, true otherwise.
+   */
+  boolean sample(void);
+
+  /**
+   * Add a sample
+   *
+   * Add a sample obtained elsewhere to the history.
+   *
+   * \param secs      the time of the sample in seconds since 2000-01-01.
+   * \param quarters  the temperature in quarter degrees C.
+   */
+  void add(uint32_t secs, int16_t quarters);
+
+  /**
+   * Get the number of samples in the history
+   *
+   * \return the number of samples.
+   */
+  inline uint16_t count(void) { return(_count); };
+
+  /**
+   * Get a sample from the history
+   *
+   * \param i the sample index, 0 for the oldest sample and count()-1 for the newest.
+   * \param s the structure to receive the sample.
+   * \return false if the index is out of range, true otherwise.
+   */
+  boolean get(uint16_t i, tempSample_t &s);
+
+  /**
+   * Get the lowest temperature in the history
+   *
+   * \return the minimum in quarter degrees C, 0 if there are no samples.
+   */
+  inline int16_t minimum(void) { return(_min); };
+
+  /**
+   * Get the highest temperature in the history
+   *
+   * \return the maximum in quarter degrees C, 0 if there are no samples.
+   */
+  inline int16_t maximum(void) { return(_max); };
+
+  /**
+   * Get the mean temperature of the history
+   *
+   * \return the mean in quarter degrees C, rounded to the nearest quarter, 0 if there are no samples.
+   */
+  int16_t mean(void);
+
+  /**
+   * Get the variance of the temperatures in the history
+   *
+   * The population variance, in (quarter degrees C) squared. Divide by 16 for
+   * degrees C squared.
+   *
+   * \return the variance, 0 if there are no samples.
+   */
+  uint32_t variance(void);
+
+  /**
+   * Export the history as packed records
+   *
+   * Copy samples into the buffer, oldest first, as TEMPLOG_RECORD_SIZE byte records
+   * of the time (4 bytes) followed by the temperature (2 bytes), both little endian.
+   * Large histories can be exported in parts by using _first_.
+   *
+   * \param buf   the buffer to receive the records.
+   * \param size  the size of _buf_ in bytes.
+   * \param first the index of the first sample to export.
+   * \return the number of records copied into the buffer.
+   */
+  uint16_t exportRecords(uint8_t *buf, uint16_t size, uint16_t first = 0);
+
+  private:
+  MD_DS3231 &_rtc;        // the RTC we are using
+  tempSample_t *_store;   // sample storage, used as a ring buffer
+  uint16_t _size;         // number of elements in _store
+  uint16_t _head;         // index of the oldest sample
+  uint16_t _count;        // number of samples in _store
+  uint32_t _intervalMs;   // milliseconds between samples
+  uint32_t _lastMs;       // millis() at the last sample
+  boolean _started;       // the first sample has been taken
+  int16_t _min, _max;     // extremes of the samples in _store
+  int32_t _sum;           // sum of the samples in _store
+  uint64_t _sumSq;        // sum of the squares of the samples in _store
+
+  void rescan(void);
+};
+
+#endif